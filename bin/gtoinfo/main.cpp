@@ -34,6 +34,7 @@
 //  DAMAGE.
 //
 #include <Gto/Reader.h>
+#include <Gto/Codec.h>
 #include <fstream>
 #include <iostream>
 #include <stdio.h>
@@ -52,6 +53,7 @@ bool readAll        = false;
 bool numericStrings = false;
 bool filtered       = false;
 bool outputInterp   = false;
+bool writeIndex     = false;
 
 typedef set<const Gto::Reader::PropertyInfo*> PropertySet;
 typedef set<const Gto::Reader::ObjectInfo*>   ObjectSet;
@@ -711,6 +713,7 @@ void usage()
          << "-i/--interpretation-strings    output interpretation strings\n"
          << "-f/--filter expr               filter shell-like expression\n"
          << "-r/--readall                   force data read\n"
+         << "-x/--index                     write a random access index for a .gz file\n"
          << "--help                         usage\n"
          << endl;
 
@@ -760,6 +763,11 @@ int main(int argc, char *argv[])
             {
                 readAll      = true;
             }
+            else if (!strcmp(arg, "-x") ||
+                     !strcmp(arg, "--index"))
+            {
+                writeIndex   = true;
+            }
             else if (!strcmp(arg, "-l") ||
                      !strcmp(arg, "--line"))
             {
@@ -800,6 +808,22 @@ int main(int argc, char *argv[])
         usage();
     }
 
+    if (writeIndex)
+    {
+        Gto::GzipIndex index;
+        string indexName = Gto::GzipIndex::indexName(inFile);
+
+        if (!index.build(inFile) || !index.write(indexName.c_str()))
+        {
+            cerr << "Error indexing file " << inFile << ": " << index.why() << endl;
+            return -1;
+        }
+
+        cout << "wrote " << indexName << " (" << index.numPoints() 
+             << " access points)" << endl;
+        return 0;
+    }
+
     unsigned int mode = 0;
     if (!outputData && !readAll) mode |= Gto::Reader::HeaderOnly;
 
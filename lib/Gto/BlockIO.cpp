@@ -0,0 +1,823 @@
+//
+//  Copyright (c) 2009, Tweak Software
+//  All rights reserved.
+// 
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//
+//     * Redistributions of source code must retain the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials
+//       provided with the distribution.
+//
+//     * Neither the name of the Tweak Software nor the names of its
+//       contributors may be used to endorse or promote products
+//       derived from this software without specific prior written
+//       permission.
+// 
+//  THIS SOFTWARE IS PROVIDED BY Tweak Software ''AS IS'' AND ANY EXPRESS
+//  OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL Tweak Software BE LIABLE FOR
+//  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+//  OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+//  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+//  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+//  USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+//  DAMAGE.
+
+#include "BlockIO.h"
+#include "Codec.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <sstream>
+#include <string.h>
+#ifdef GTO_SUPPORT_ZIP
+#include <zlib.h>
+#endif
+
+namespace Gto {
+using namespace std;
+
+static void
+swapWords(void *data, size_t size)
+{
+    struct bytes { char c[4]; };
+
+    bytes* ip = reinterpret_cast<bytes*>(data);
+
+    for (size_t i=0; i<size; i++)
+    {
+        bytes temp = ip[i];
+        ip[i].c[0] = temp.c[3];
+        ip[i].c[1] = temp.c[2];
+        ip[i].c[2] = temp.c[1];
+        ip[i].c[3] = temp.c[0];
+    }
+}
+
+static void
+swapInt64(uint64& i)
+{
+    uint32* w = reinterpret_cast<uint32*>(&i);
+    swapWords(w, 2);
+    swap(w[0], w[1]);
+}
+
+//
+//  Decompresses one block. Blocks which are stored (the compressed
+//  size is the same as the logical size) are just copied.
+//
+
+static bool
+inflateBlock(const Codec* codec, 
+             const char* in, size_t inSize,
+             char* out, size_t outSize)
+{
+    if (inSize == outSize)
+    {
+        memcpy(out, in, outSize);
+        return true;
+    }
+
+    return codec->decompress(in, inSize, out, outSize);
+}
+
+//
+//  A block being decompressed by the ThreadPool
+//
+
+struct BlockJob : public ThreadPool::Job
+{
+    BlockJob(const Codec* c, size_t b, size_t s, size_t capacity) 
+        : codec(c), block(b), size(s), data(capacity), ok(false) {}
+
+    virtual void run()
+    {
+        ok = inflateBlock(codec, 
+                          compressed.empty() ? 0 : &compressed.front(),
+                          compressed.size(),
+                          data.empty() ? 0 : &data.front(),
+                          size);
+    }
+
+    const Codec*        codec;
+    size_t              block;
+    size_t              size;
+    std::vector<char>   compressed;
+    std::vector<char>   data;
+    bool                ok;
+};
+
+//
+//  A chunk being compressed by the ThreadPool
+//
+
+struct ChunkJob : public ThreadPool::Job
+{
+    ChunkJob(const ChunkWriter* w) : writer(w), ok(false) {}
+
+    virtual void run()
+    {
+        ok = writer->compressChunk(&data.front(), data.size(), compressed);
+    }
+
+    const ChunkWriter*  writer;
+    std::vector<char>   data;
+    std::vector<char>   compressed;
+    bool                ok;
+};
+
+//----------------------------------------------------------------------
+
+ChunkWriter::ChunkWriter(ostream& out, size_t chunkSize, size_t numThreads)
+    : m_out(out),
+      m_chunkSize(chunkSize),
+      m_pool(0),
+      m_offset(0),
+      m_size(0),
+      m_error(false),
+      m_finished(false)
+{
+    if (numThreads != 1) m_pool = new ThreadPool(numThreads);
+    m_chunk.reserve(m_chunkSize);
+}
+
+ChunkWriter::~ChunkWriter()
+{
+    for (size_t i = 0; i < m_queue.size(); i++)
+    {
+        m_pool->wait(m_queue[i]);
+        delete m_queue[i];
+    }
+
+    delete m_pool;
+}
+
+bool
+ChunkWriter::writeRaw(const void* data, size_t size)
+{
+    if (m_error) return false;
+    m_out.write((const char*)data, size);
+
+    if (!m_out)
+    {
+        m_error = true;
+        return false;
+    }
+
+    m_offset += size;
+    return true;
+}
+
+bool
+ChunkWriter::write(const void* data, size_t size)
+{
+    const char* p = (const char*)data;
+
+    while (size && !m_error)
+    {
+        size_t n = std::min(size, m_chunkSize - m_chunk.size());
+        m_chunk.insert(m_chunk.end(), p, p + n);
+        m_size += n;
+        p      += n;
+        size   -= n;
+
+        if (m_chunk.size() == m_chunkSize) flushChunk();
+    }
+
+    return !m_error;
+}
+
+bool
+ChunkWriter::writeJob(ChunkJob* job)
+{
+    if (!job->ok) m_error = true;
+
+    if (!m_error)
+    {
+        uint64 offset = m_offset;
+
+        if (writeRaw(&job->compressed.front(), job->compressed.size()))
+        {
+            chunkWritten(offset, job->compressed.size(), job->data.size());
+        }
+    }
+
+    delete job;
+    return !m_error;
+}
+
+bool
+ChunkWriter::flushChunk()
+{
+    if (m_chunk.empty()) return true;
+
+    ChunkJob* job = new ChunkJob(this);
+    job->data.swap(m_chunk);
+    m_chunk.reserve(m_chunkSize);
+
+    if (!m_pool)
+    {
+        job->run();
+        return writeJob(job);
+    }
+
+    //
+    //  Keep a couple of chunks per thread in flight. The oldest is
+    //  written out when the window is full.
+    //
+
+    m_pool->add(job);
+    m_queue.push_back(job);
+
+    while (m_queue.size() > m_pool->numThreads() * 2)
+    {
+        ChunkJob* next = m_queue.front();
+        m_queue.pop_front();
+        m_pool->wait(next);
+        writeJob(next);
+    }
+
+    return !m_error;
+}
+
+bool
+ChunkWriter::finish()
+{
+    if (m_finished) return !m_error;
+    m_finished = true;
+
+    flushChunk();
+
+    while (!m_queue.empty())
+    {
+        ChunkJob* next = m_queue.front();
+        m_queue.pop_front();
+        m_pool->wait(next);
+        writeJob(next);
+    }
+
+    writeTrailer();
+    m_out.flush();
+    return !m_error;
+}
+
+//----------------------------------------------------------------------
+
+BlockWriter::BlockWriter(ostream& out, 
+                         uint32 codec, 
+                         size_t blockSize,
+                         size_t numThreads)
+    : ChunkWriter(out, blockSize ? blockSize : DefaultBlockSize, numThreads),
+      m_codec(Codec::find(codec))
+{
+    if (!m_codec) m_codec = Codec::find(ZlibCodec);
+    if (!m_codec) m_codec = Codec::find(NoCodec);
+
+    BlockHeader header;
+    header.magic     = BlockHeader::Magic;
+    header.version   = GTO_BLOCK_VERSION;
+    header.codec     = m_codec->id();
+    header.blockSize = chunkSize();
+
+    writeRaw(&header, sizeof(BlockHeader));
+}
+
+BlockWriter::~BlockWriter()
+{
+    finish();
+}
+
+uint32
+BlockWriter::codec() const
+{
+    return m_codec->id();
+}
+
+bool
+BlockWriter::compressChunk(const char* in, size_t size, vector<char>& out) const
+{
+    if (m_codec->id() != NoCodec)
+    {
+        size_t n = m_codec->compressBound(size);
+        out.resize(n);
+
+        if (!m_codec->compress(in, size, &out.front(), n)) return false;
+
+        //
+        //  A block which did not get smaller is stored as is. The
+        //  reader can tell because the sizes are the same.
+        //
+
+        if (n < size)
+        {
+            out.resize(n);
+            return true;
+        }
+    }
+
+    out.assign(in, in + size);
+    return true;
+}
+
+void
+BlockWriter::chunkWritten(uint64 offset, size_t compressedSize, size_t size)
+{
+    BlockIndexEntry entry;
+    entry.offset         = offset;
+    entry.compressedSize = compressedSize;
+    entry.size           = size;
+    m_index.push_back(entry);
+}
+
+bool
+BlockWriter::writeTrailer()
+{
+    BlockTrailer trailer;
+    trailer.indexOffset = offset();
+    trailer.numBlocks   = m_index.size();
+    trailer.size        = size();
+    trailer.flags       = 0;
+    trailer.magic       = BlockHeader::Magic;
+
+    if (!m_index.empty())
+    {
+        writeRaw(&m_index.front(), m_index.size() * sizeof(BlockIndexEntry));
+    }
+
+    return writeRaw(&trailer, sizeof(BlockTrailer));
+}
+
+//----------------------------------------------------------------------
+
+GzipWriter::GzipWriter(ostream& out, size_t numThreads, size_t chunkSize)
+    : ChunkWriter(out, chunkSize ? chunkSize : DefaultChunkSize, numThreads)
+{
+}
+
+GzipWriter::~GzipWriter()
+{
+    finish();
+}
+
+bool
+GzipWriter::compressChunk(const char* in, size_t size, vector<char>& out) const
+{
+#ifdef GTO_SUPPORT_ZIP
+    z_stream z;
+    memset(&z, 0, sizeof(z_stream));
+
+    //
+    //  15 + 16 window bits asks for a gzip header and trailer
+    //
+
+    if (deflateInit2(&z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, 
+                     Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        return false;
+    }
+
+    out.resize(deflateBound(&z, size) + 32);
+    z.next_in   = (Bytef*)in;
+    z.avail_in  = size;
+    z.next_out  = (Bytef*)&out.front();
+    z.avail_out = out.size();
+
+    int status = deflate(&z, Z_FINISH);
+    out.resize(z.total_out);
+    deflateEnd(&z);
+    return status == Z_STREAM_END;
+#else
+    return false;
+#endif
+}
+
+bool
+GzipWriter::writeTrailer()
+{
+    //
+    //  An empty file still needs one member to be a gzip file
+    //
+
+    if (size() == 0)
+    {
+        vector<char> member;
+        return compressChunk(0, 0, member) && writeRaw(&member.front(), member.size());
+    }
+
+    return true;
+}
+
+//----------------------------------------------------------------------
+
+BlockReader::BlockReader()
+    : m_in(0),
+      m_inRAM(0),
+      m_inRAMSize(0),
+      m_base(0),
+      m_fileSize(0),
+      m_codec(0),
+      m_swapped(false),
+      m_size(0),
+      m_pos(0),
+      m_current(size_t(-1)),
+      m_blockCapacity(0),
+      m_pool(0),
+      m_nextScheduled(0)
+{
+    memset(&m_header, 0, sizeof(BlockHeader));
+}
+
+BlockReader::~BlockReader()
+{
+    clearQueue();
+    delete m_pool;
+}
+
+bool
+BlockReader::fail(const std::string& why)
+{
+    if (m_why.empty()) m_why = why;
+    return false;
+}
+
+bool
+BlockReader::open(istream& in)
+{
+    m_in   = &in;
+    m_base = in.tellg();
+    in.seekg(0, ios::end);
+    uint64 end = in.tellg();
+
+    if (!in || end < m_base) return fail("block compressed input is not seekable");
+
+    m_fileSize = end - m_base;
+    return openIndex();
+}
+
+bool
+BlockReader::open(const char* data, size_t size)
+{
+    m_inRAM     = data;
+    m_inRAMSize = size;
+    m_base      = 0;
+    m_fileSize  = size;
+    return openIndex();
+}
+
+bool
+BlockReader::readRaw(uint64 offset, char* buffer, size_t size)
+{
+    if (offset + size > m_fileSize)
+    {
+        return fail("block compressed file is truncated");
+    }
+
+    if (m_inRAM)
+    {
+        memcpy(buffer, m_inRAM + offset, size);
+    }
+    else
+    {
+        m_in->clear();
+        m_in->seekg(m_base + offset, ios::beg);
+        m_in->read(buffer, size);
+
+        if (!*m_in) return fail("block compressed file read failed");
+    }
+
+    return true;
+}
+
+bool
+BlockReader::openIndex()
+{
+    BlockTrailer trailer;
+
+    if (m_fileSize < sizeof(BlockHeader) + sizeof(BlockTrailer))
+    {
+        return fail("block compressed file is truncated");
+    }
+
+    if (!readRaw(0, (char*)&m_header, sizeof(BlockHeader)) ||
+        !readRaw(m_fileSize - sizeof(BlockTrailer), 
+                 (char*)&trailer, sizeof(BlockTrailer)))
+    {
+        return false;
+    }
+
+    if (m_header.magic == BlockHeader::Cigam)
+    {
+        m_swapped = true;
+        swapWords(&m_header, sizeof(BlockHeader) / sizeof(uint32));
+        swapInt64(trailer.indexOffset);
+        swapInt64(trailer.numBlocks);
+        swapInt64(trailer.size);
+        swapWords(&trailer.flags, 2);
+    }
+    else if (m_header.magic != BlockHeader::Magic)
+    {
+        return fail("bad block compressed file magic number");
+    }
+
+    if (trailer.magic != BlockHeader::Magic)
+    {
+        return fail("bad block compressed file trailer");
+    }
+
+    if (m_header.version != GTO_BLOCK_VERSION)
+    {
+        return fail("unsupported block compressed file version");
+    }
+
+    if (m_header.blockSize == 0)
+    {
+        return fail("bad block size in block compressed file");
+    }
+
+    if (!(m_codec = Codec::find(m_header.codec)))
+    {
+        return fail("block compressed file uses an unsupported codec");
+    }
+
+    //
+    //  Checked so that nothing can overflow: the counts come from the
+    //  file
+    //
+
+    const uint64 limit = m_fileSize - sizeof(BlockTrailer);
+
+    if (trailer.indexOffset > limit ||
+        trailer.numBlocks > (limit - trailer.indexOffset) / sizeof(BlockIndexEntry))
+    {
+        return fail("bad block compressed file index");
+    }
+
+    m_index.resize(trailer.numBlocks);
+
+    if (!m_index.empty() && 
+        !readRaw(trailer.indexOffset, (char*)&m_index.front(),
+                 m_index.size() * sizeof(BlockIndexEntry)))
+    {
+        return false;
+    }
+
+    uint64 total   = 0;
+    size_t largest = 0;
+
+    for (size_t i = 0; i < m_index.size(); i++)
+    {
+        BlockIndexEntry& e = m_index[i];
+
+        if (m_swapped)
+        {
+            swapInt64(e.offset);
+            swapWords(&e.compressedSize, 2);
+        }
+
+        //
+        //  Every block but the last must be full -- that's what makes
+        //  finding a logical offset a division.
+        //
+
+        if (e.size > m_header.blockSize ||
+            (e.size != m_header.blockSize && i != m_index.size() - 1) ||
+            e.offset + e.compressedSize > trailer.indexOffset)
+        {
+            return fail("bad block compressed file index");
+        }
+
+        total  += e.size;
+        largest = std::max(largest, size_t(e.size));
+    }
+
+    if (total != trailer.size)
+    {
+        return fail("bad block compressed file index");
+    }
+
+    //
+    //  The block buffers are only as large as the largest block in the
+    //  index, not the block size in the header which nothing has
+    //  checked
+    //
+
+    m_size          = trailer.size;
+    m_pos           = 0;
+    m_blockCapacity = largest;
+    m_block.resize(m_blockCapacity);
+    return true;
+}
+
+bool
+BlockReader::decompressBlock(size_t b, char* buffer)
+{
+    const BlockIndexEntry& e = m_index[b];
+
+    if (e.compressedSize == e.size)
+    {
+        return readRaw(e.offset, buffer, e.size);
+    }
+
+    m_compressed.resize(e.compressedSize);
+    if (!readRaw(e.offset, &m_compressed.front(), e.compressedSize)) return false;
+
+    if (!inflateBlock(m_codec, &m_compressed.front(), e.compressedSize,
+                      buffer, e.size))
+    {
+        ostringstream str;
+        str << "failed to decompress block " << b;
+        return fail(str.str());
+    }
+
+    return true;
+}
+
+void
+BlockReader::prefetch(const vector<size_t>& blocks, size_t numThreads)
+{
+    clearQueue();
+    if (!m_pool) m_pool = new ThreadPool(numThreads);
+
+    m_schedule      = blocks;
+    m_nextScheduled = 0;
+    queueBlocks();
+}
+
+void
+BlockReader::queueBlocks()
+{
+    //
+    //  Keep a few blocks per thread in flight. The compressed data is
+    //  read here so the input is only touched by the calling thread.
+    //
+
+    const size_t window = m_pool->numThreads() * 4 + 1;
+
+    while (m_queue.size() < window && 
+           m_nextScheduled < m_schedule.size() &&
+           good())
+    {
+        size_t b = m_schedule[m_nextScheduled++];
+        if (b >= m_index.size()) continue;
+
+        const BlockIndexEntry& e = m_index[b];
+        BlockJob* job = new BlockJob(m_codec, b, e.size, m_blockCapacity);
+        job->compressed.resize(e.compressedSize);
+
+        if (e.compressedSize &&
+            !readRaw(e.offset, &job->compressed.front(), e.compressedSize))
+        {
+            delete job;
+            break;
+        }
+
+        m_pool->add(job);
+        m_queue.push_back(job);
+    }
+}
+
+void
+BlockReader::clearQueue()
+{
+    for (size_t i = 0; i < m_queue.size(); i++)
+    {
+        m_pool->wait(m_queue[i]);
+        delete m_queue[i];
+    }
+
+    m_queue.clear();
+    m_schedule.clear();
+    m_nextScheduled = 0;
+}
+
+bool
+BlockReader::loadBlock(size_t b)
+{
+    if (b == m_current) return true;
+    m_current = size_t(-1);
+
+    //
+    //  Prefetched blocks in front of this one were skipped
+    //
+
+    while (!m_queue.empty() && m_queue.front()->block < b)
+    {
+        m_pool->wait(m_queue.front());
+        delete m_queue.front();
+        m_queue.pop_front();
+    }
+
+    if (!m_queue.empty() && m_queue.front()->block == b)
+    {
+        BlockJob* job = m_queue.front();
+        m_queue.pop_front();
+        m_pool->wait(job);
+
+        bool ok = job->ok;
+        if (ok) m_block.swap(job->data);
+        delete job;
+
+        queueBlocks();
+
+        if (!ok)
+        {
+            ostringstream str;
+            str << "failed to decompress block " << b;
+            return fail(str.str());
+        }
+    }
+    else if (!decompressBlock(b, m_block.empty() ? 0 : &m_block.front()))
+    {
+        return false;
+    }
+
+    m_current = b;
+    return true;
+}
+
+size_t
+BlockReader::read(char* buffer, size_t size)
+{
+    const uint64 blockSize = m_header.blockSize;
+    size_t       n         = 0;
+
+    while (n < size && m_pos < m_size && good())
+    {
+        size_t b      = size_t(m_pos / blockSize);
+        size_t offset = size_t(m_pos - b * blockSize);
+        size_t count  = std::min(size_t(m_index[b].size) - offset, size - n);
+
+        if (b != m_current && offset == 0 && count == m_index[b].size &&
+            m_queue.empty())
+        {
+            //
+            //  The whole block is wanted: skip the intermediate copy
+            //
+
+            if (!decompressBlock(b, buffer + n)) break;
+        }
+        else
+        {
+            if (!loadBlock(b)) break;
+            memcpy(buffer + n, &m_block[offset], count);
+        }
+
+        n     += count;
+        m_pos += count;
+    }
+
+    if (n != size) fail("read past end of block compressed file");
+    return n;
+}
+
+bool
+BlockReader::get(char& c)
+{
+    if (m_pos < m_size && m_current == size_t(m_pos / m_header.blockSize))
+    {
+        c = m_block[size_t(m_pos - uint64(m_current) * m_header.blockSize)];
+        m_pos++;
+        return true;
+    }
+
+    if (read(&c, 1) == 1) return true;
+    c = 0;
+    return false;
+}
+
+const char*
+BlockReader::peek(size_t& available)
+{
+    available = 0;
+    if (m_pos >= m_size || !good()) return 0;
+
+    size_t b      = size_t(m_pos / m_header.blockSize);
+    size_t offset = size_t(m_pos - uint64(b) * m_header.blockSize);
+    if (!loadBlock(b)) return 0;
+
+    available = size_t(m_index[b].size) - offset;
+    return &m_block[offset];
+}
+
+void
+BlockReader::seekTo(uint64 pos)
+{
+    m_pos = std::min(pos, m_size);
+}
+
+void
+BlockReader::seekForward(uint64 bytes)
+{
+    m_pos = std::min(m_pos + bytes, m_size);
+}
+
+} // Gto
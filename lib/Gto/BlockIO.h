@@ -0,0 +1,262 @@
+//
+//  Copyright (c) 2009, Tweak Software
+//  All rights reserved.
+// 
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//
+//     * Redistributions of source code must retain the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials
+//       provided with the distribution.
+//
+//     * Neither the name of the Tweak Software nor the names of its
+//       contributors may be used to endorse or promote products
+//       derived from this software without specific prior written
+//       permission.
+// 
+//  THIS SOFTWARE IS PROVIDED BY Tweak Software ''AS IS'' AND ANY EXPRESS
+//  OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL Tweak Software BE LIABLE FOR
+//  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+//  OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+//  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+//  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+//  USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+//  DAMAGE.
+
+#ifndef __Gto__BlockIO__h__
+#define __Gto__BlockIO__h__
+#include <Gto/Header.h>
+#include <deque>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace Gto {
+
+class Codec;
+class ThreadPool;
+struct BlockJob;
+struct ChunkJob;
+
+//
+//  class ChunkWriter
+//
+//  Base class of the writers which compress their input in fixed size
+//  chunks. Bytes passed to write() are accumulated until a chunk is
+//  full. With more than one thread the chunks are compressed on a
+//  ThreadPool while the caller carries on; the results are written to
+//  the stream in order by the calling thread.
+//
+
+class ChunkWriter
+{
+public:
+    ChunkWriter(std::ostream&, size_t chunkSize, size_t numThreads);
+    virtual ~ChunkWriter();
+
+    bool                write(const void*, size_t);
+
+    //
+    //  Writes the last partial chunk and whatever follows the chunks.
+    //  Subclasses must call this from their destructors.
+    //
+
+    bool                finish();
+
+    uint64              size() const { return m_size; }
+    size_t              chunkSize() const { return m_chunkSize; }
+
+protected:
+    //
+    //  compressChunk() may be called on a worker thread at the same
+    //  time as the other chunks in flight.
+    //
+
+    virtual bool        compressChunk(const char* in, size_t size,
+                                      std::vector<char>& out) const = 0;
+    virtual void        chunkWritten(uint64 offset, 
+                                     size_t compressedSize,
+                                     size_t size) {}
+    virtual bool        writeTrailer() { return true; }
+
+    bool                writeRaw(const void*, size_t);
+    uint64              offset() const { return m_offset; }
+
+private:
+    bool                flushChunk();
+    bool                writeJob(ChunkJob*);
+
+    friend struct ChunkJob;
+
+private:
+    std::ostream&       m_out;
+    size_t              m_chunkSize;
+    std::vector<char>   m_chunk;
+    ThreadPool*         m_pool;
+    std::deque<ChunkJob*> m_queue;      // chunks being compressed
+    uint64              m_offset;       // file bytes written
+    uint64              m_size;         // logical bytes written
+    bool                m_error;
+    bool                m_finished;
+};
+
+//
+//  class BlockWriter
+//
+//  Writes a block compressed file (see Header.h) to a stream. finish()
+//  writes the last partial block followed by the index and trailer.
+//
+//  If the requested codec isn't available zlib is used instead, and if
+//  that isn't either the blocks are stored uncompressed.
+//
+
+class BlockWriter : public ChunkWriter
+{
+public:
+    typedef std::vector<BlockIndexEntry> Index;
+
+    static const size_t DefaultBlockSize = 256 * 1024;
+
+    BlockWriter(std::ostream&, 
+                uint32 codec = ZlibCodec,
+                size_t blockSize = DefaultBlockSize,
+                size_t numThreads = 1);
+    virtual ~BlockWriter();
+
+    uint32              codec() const;
+
+protected:
+    virtual bool        compressChunk(const char*, size_t, 
+                                      std::vector<char>&) const;
+    virtual void        chunkWritten(uint64, size_t, size_t);
+    virtual bool        writeTrailer();
+
+private:
+    const Codec*        m_codec;
+    Index               m_index;
+};
+
+//
+//  class GzipWriter
+//
+//  Writes a gzip file made of independently compressed members, one
+//  per chunk, so the chunks can be compressed in parallel. gzread()
+//  and gunzip read the members back as a single stream.
+//
+
+class GzipWriter : public ChunkWriter
+{
+public:
+    static const size_t DefaultChunkSize = 1024 * 1024;
+
+    GzipWriter(std::ostream&, 
+               size_t numThreads = 0,
+               size_t chunkSize = DefaultChunkSize);
+    virtual ~GzipWriter();
+
+protected:
+    virtual bool        compressChunk(const char*, size_t, 
+                                      std::vector<char>&) const;
+    virtual bool        writeTrailer();
+};
+
+//
+//  class BlockReader
+//
+//  Presents the logical file inside of a block compressed file as a
+//  seekable byte stream. Only the blocks touched by read() are
+//  decompressed. The input must be seekable: the index is read from
+//  the end of the file when it is opened.
+//
+//  If the blocks which will be read are known in advance they can be
+//  handed to prefetch(). They will be decompressed on a pool of
+//  worker threads while the caller consumes the ones in front of them.
+//  The compressed data is still read from the input by the calling
+//  thread.
+//
+
+class BlockReader
+{
+public:
+    typedef std::vector<BlockIndexEntry> Index;
+
+    BlockReader();
+    ~BlockReader();
+
+    //
+    //  The stream should be positioned at the start of the
+    //  BlockHeader.
+    //
+
+    bool                open(std::istream&);
+    bool                open(const char* data, size_t size);
+
+    void                prefetch(const std::vector<size_t>& blocks,
+                                 size_t numThreads);
+
+    size_t              read(char*, size_t);
+    bool                get(char&);
+
+    //
+    //  Returns the rest of the current block without consuming it
+    //  (available is 0 at the end of the file).
+    //
+
+    const char*         peek(size_t& available);
+
+    void                seekTo(uint64);
+    void                seekForward(uint64);
+
+    uint64              tell() const { return m_pos; }
+    uint64              size() const { return m_size; }
+    bool                good() const { return m_why.empty(); }
+
+    const BlockHeader&  header() const { return m_header; }
+    const Index&        index() const { return m_index; }
+    const std::string&  why() const { return m_why; }
+
+private:
+    bool                openIndex();
+    bool                readRaw(uint64 offset, char*, size_t);
+    bool                decompressBlock(size_t, char*);
+    bool                loadBlock(size_t);
+    bool                fail(const std::string&);
+    void                queueBlocks();
+    void                clearQueue();
+
+private:
+    std::istream*       m_in;
+    const char*         m_inRAM;
+    size_t              m_inRAMSize;
+    uint64              m_base;         // input position of the BlockHeader
+    uint64              m_fileSize;
+    BlockHeader         m_header;
+    Index               m_index;
+    const Codec*        m_codec;
+    bool                m_swapped;
+    uint64              m_size;
+    uint64              m_pos;
+    size_t              m_current;      // block held in m_block
+    size_t              m_blockCapacity; // largest block in the index
+    std::vector<char>   m_block;
+    std::vector<char>   m_compressed;
+    std::string         m_why;
+    ThreadPool*         m_pool;
+    std::vector<size_t> m_schedule;     // blocks to prefetch
+    size_t              m_nextScheduled;
+    std::deque<BlockJob*> m_queue;      // blocks being decompressed
+};
+
+} // Gto
+
+#endif // __Gto__BlockIO__h__
@@ -0,0 +1,994 @@
+//
+//  Copyright (c) 2009, Tweak Software
+//  All rights reserved.
+// 
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//
+//     * Redistributions of source code must retain the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials
+//       provided with the distribution.
+//
+//     * Neither the name of the Tweak Software nor the names of its
+//       contributors may be used to endorse or promote products
+//       derived from this software without specific prior written
+//       permission.
+// 
+//  THIS SOFTWARE IS PROVIDED BY Tweak Software ''AS IS'' AND ANY EXPRESS
+//  OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL Tweak Software BE LIABLE FOR
+//  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+//  OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+//  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+//  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+//  USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+//  DAMAGE.
+
+#include "Codec.h"
+#include <algorithm>
+#include <vector>
+#include <string.h>
+#include <stdio.h>
+#ifdef GTO_SUPPORT_ZIP
+#include <zlib.h>
+#endif
+#ifdef GTO_SUPPORT_LZ4
+#include <lz4.h>
+#endif
+#ifdef GTO_SUPPORT_ZSTD
+#include <zstd.h>
+#endif
+
+namespace Gto {
+using namespace std;
+
+//
+//  Blocks which don't compress are stored as is by the BlockWriter so
+//  the stored codec only needs to copy.
+//
+
+class StoredCodec : public Codec
+{
+public:
+    virtual uint32 id() const { return NoCodec; }
+    virtual const char* name() const { return "none"; }
+    virtual size_t compressBound(size_t size) const { return size; }
+
+    virtual bool compress(const char* in, size_t inSize,
+                          char* out, size_t& outSize) const
+    {
+        if (outSize < inSize) return false;
+        memcpy(out, in, inSize);
+        outSize = inSize;
+        return true;
+    }
+
+    virtual bool decompress(const char* in, size_t inSize,
+                            char* out, size_t outSize) const
+    {
+        if (inSize != outSize) return false;
+        memcpy(out, in, outSize);
+        return true;
+    }
+};
+
+#ifdef GTO_SUPPORT_ZIP
+class ZlibBlockCodec : public Codec
+{
+public:
+    virtual uint32 id() const { return ZlibCodec; }
+    virtual const char* name() const { return "zlib"; }
+    virtual size_t compressBound(size_t size) const { return ::compressBound(size); }
+
+    virtual bool compress(const char* in, size_t inSize,
+                          char* out, size_t& outSize) const
+    {
+        uLongf n = outSize;
+        if (::compress((Bytef*)out, &n, (const Bytef*)in, inSize) != Z_OK) return false;
+        outSize = n;
+        return true;
+    }
+
+    virtual bool decompress(const char* in, size_t inSize,
+                            char* out, size_t outSize) const
+    {
+        uLongf n = outSize;
+
+        return uncompress((Bytef*)out, &n, (const Bytef*)in, inSize) == Z_OK &&
+               n == outSize;
+    }
+};
+#endif
+
+#ifdef GTO_SUPPORT_LZ4
+class LZ4BlockCodec : public Codec
+{
+public:
+    virtual uint32 id() const { return Lz4Codec; }
+    virtual const char* name() const { return "lz4"; }
+    virtual size_t compressBound(size_t size) const { return LZ4_compressBound(int(size)); }
+
+    virtual bool compress(const char* in, size_t inSize,
+                          char* out, size_t& outSize) const
+    {
+        int n = LZ4_compress_default(in, out, int(inSize), int(outSize));
+        if (n <= 0) return false;
+        outSize = n;
+        return true;
+    }
+
+    virtual bool decompress(const char* in, size_t inSize,
+                            char* out, size_t outSize) const
+    {
+        return LZ4_decompress_safe(in, out, int(inSize), int(outSize)) == int(outSize);
+    }
+};
+#endif
+
+#ifdef GTO_SUPPORT_ZSTD
+class ZstdBlockCodec : public Codec
+{
+public:
+    virtual uint32 id() const { return ZstdCodec; }
+    virtual const char* name() const { return "zstd"; }
+    virtual size_t compressBound(size_t size) const { return ZSTD_compressBound(size); }
+
+    virtual bool compress(const char* in, size_t inSize,
+                          char* out, size_t& outSize) const
+    {
+        size_t n = ZSTD_compress(out, outSize, in, inSize, 3);
+        if (ZSTD_isError(n)) return false;
+        outSize = n;
+        return true;
+    }
+
+    virtual bool decompress(const char* in, size_t inSize,
+                            char* out, size_t outSize) const
+    {
+        size_t n = ZSTD_decompress(out, outSize, in, inSize);
+        return !ZSTD_isError(n) && n == outSize;
+    }
+};
+#endif
+
+//----------------------------------------------------------------------
+
+static vector<const Codec*>&
+codecs()
+{
+    static vector<const Codec*> all;
+
+    if (all.empty())
+    {
+        static StoredCodec stored;
+        all.push_back(&stored);
+
+#ifdef GTO_SUPPORT_ZIP
+        static ZlibBlockCodec zlib;
+        all.push_back(&zlib);
+#endif
+#ifdef GTO_SUPPORT_LZ4
+        static LZ4BlockCodec lz4;
+        all.push_back(&lz4);
+#endif
+#ifdef GTO_SUPPORT_ZSTD
+        static ZstdBlockCodec zstd;
+        all.push_back(&zstd);
+#endif
+    }
+
+    return all;
+}
+
+Codec::~Codec() {}
+
+const Codec*
+Codec::find(uint32 id)
+{
+    vector<const Codec*>& all = codecs();
+
+    for (size_t i = 0; i < all.size(); i++)
+    {
+        if (all[i]->id() == id) return all[i];
+    }
+
+    return 0;
+}
+
+void
+Codec::registerCodec(const Codec* codec)
+{
+    vector<const Codec*>& all = codecs();
+
+    for (size_t i = 0; i < all.size(); i++)
+    {
+        if (all[i]->id() == codec->id())
+        {
+            all[i] = codec;
+            return;
+        }
+    }
+
+    all.push_back(codec);
+}
+
+//----------------------------------------------------------------------
+
+CompressedFile::CompressedFile() : m_file(0) {}
+
+CompressedFile::~CompressedFile()
+{
+    close();
+}
+
+bool
+CompressedFile::supported()
+{
+#ifdef GTO_SUPPORT_ZIP
+    return true;
+#else
+    return false;
+#endif
+}
+
+#ifdef GTO_SUPPORT_ZIP
+
+bool
+CompressedFile::open(const char* filename, const char* mode)
+{
+    close();
+    m_file = gzopen(filename, mode);
+    return m_file != 0;
+}
+
+void
+CompressedFile::close()
+{
+    if (m_file) gzclose((gzFile)m_file);
+    m_file = 0;
+}
+
+//
+//  zlib takes unsigned lengths and returns ints so large requests are
+//  split up. gzseek64() and gztell64() are used where zlib has them
+//  (Z_LARGE64) in case z_off_t is only 32 bits.
+//
+
+static const size_t MaxChunk = 1 << 30;
+
+size_t
+CompressedFile::read(void* buffer, size_t size)
+{
+    char*  p = (char*)buffer;
+    size_t n = 0;
+
+    while (n < size)
+    {
+        unsigned chunk = unsigned(std::min(size - n, MaxChunk));
+        int r = gzread((gzFile)m_file, p + n, chunk);
+        if (r <= 0) break;
+        n += r;
+    }
+
+    return n;
+}
+
+int
+CompressedFile::get()
+{
+    return gzgetc((gzFile)m_file);
+}
+
+bool
+CompressedFile::write(const void* data, size_t size)
+{
+    const char* p = (const char*)data;
+
+    while (size)
+    {
+        unsigned chunk = unsigned(std::min(size, MaxChunk));
+        if (gzwrite((gzFile)m_file, (void*)p, chunk) != int(chunk)) return false;
+        p    += chunk;
+        size -= chunk;
+    }
+
+    return true;
+}
+
+bool
+CompressedFile::seek(int64 offset, int whence)
+{
+#ifdef Z_LARGE64
+    return gzseek64((gzFile)m_file, offset, whence) != -1;
+#else
+    return gzseek((gzFile)m_file, z_off_t(offset), whence) != -1;
+#endif
+}
+
+int64
+CompressedFile::tell()
+{
+#ifdef Z_LARGE64
+    return gztell64((gzFile)m_file);
+#else
+    return gztell((gzFile)m_file);
+#endif
+}
+
+bool
+CompressedFile::direct()
+{
+    return m_file && gzdirect((gzFile)m_file);
+}
+
+std::string
+CompressedFile::error()
+{
+    int zError = 0;
+    const char* e = m_file ? gzerror((gzFile)m_file, &zError) : 0;
+    return e ? e : "";
+}
+
+#else
+
+bool CompressedFile::open(const char*, const char*) { return false; }
+void CompressedFile::close() {}
+size_t CompressedFile::read(void*, size_t) { return 0; }
+int  CompressedFile::get() { return -1; }
+bool CompressedFile::write(const void*, size_t) { return false; }
+bool CompressedFile::seek(int64, int) { return false; }
+int64 CompressedFile::tell() { return -1; }
+bool CompressedFile::direct() { return false; }
+std::string CompressedFile::error() { return "not compiled with zlib support"; }
+
+#endif
+
+//----------------------------------------------------------------------
+
+//
+//  The index file is a GzipIndexHeader followed by the access points
+//  and then the windows. It is written in native byte order: an index
+//  from a machine with the other order fails to read and is rebuilt.
+//
+
+struct GzipIndexHeader
+{
+    static const uint32 Magic   = 0x58495a47;   // "GZIX"
+    static const uint32 Version = 1;
+
+    uint32          magic;
+    uint32          version;
+    uint64          compressedSize;
+    uint64          uncompressedSize;
+    uint64          numPoints;
+    uint64          numWindows;
+    unsigned char   trailer[8];
+};
+
+GzipIndex::GzipIndex() : m_compressedSize(0), m_uncompressedSize(0) 
+{
+    memset(m_trailer, 0, sizeof(m_trailer));
+}
+
+std::string
+GzipIndex::indexName(const char* filename)
+{
+    return std::string(filename) + ".idx";
+}
+
+bool
+GzipIndex::fail(const std::string& why)
+{
+    m_why = why;
+    return false;
+}
+
+bool
+GzipIndex::readTrailer(const char* filename, uint64& size, unsigned char* trailer)
+{
+    FILE* file = fopen(filename, "rb");
+    if (!file) return false;
+
+    bool ok = fseeko(file, 0, SEEK_END) == 0;
+    off_t end = ftello(file);
+
+    ok = ok && end >= 8 && 
+         fseeko(file, end - 8, SEEK_SET) == 0 &&
+         fread(trailer, 1, 8, file) == 8;
+
+    fclose(file);
+    size = uint64(end);
+    return ok;
+}
+
+bool
+GzipIndex::matches(const char* filename)
+{
+    uint64        size = 0;
+    unsigned char trailer[8];
+
+    return readTrailer(filename, size, trailer) && 
+           size == m_compressedSize &&
+           !memcmp(trailer, m_trailer, sizeof(trailer));
+}
+
+const GzipIndex::AccessPoint*
+GzipIndex::find(uint64 offset) const
+{
+    if (m_points.empty() || offset < m_points.front().out) return 0;
+
+    size_t lo = 0;
+    size_t hi = m_points.size();
+
+    while (hi - lo > 1)
+    {
+        size_t mid = (lo + hi) / 2;
+        if (m_points[mid].out <= offset) lo = mid;
+        else hi = mid;
+    }
+
+    return &m_points[lo];
+}
+
+bool
+GzipIndex::write(const char* indexFile)
+{
+    GzipIndexHeader header;
+    header.magic            = GzipIndexHeader::Magic;
+    header.version          = GzipIndexHeader::Version;
+    header.compressedSize   = m_compressedSize;
+    header.uncompressedSize = m_uncompressedSize;
+    header.numPoints        = m_points.size();
+    header.numWindows       = m_windows.size() / WindowSize;
+    memcpy(header.trailer, m_trailer, sizeof(m_trailer));
+
+    FILE* file = fopen(indexFile, "wb");
+    if (!file) return fail(std::string("can't write ") + indexFile);
+
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+
+    if (ok && !m_points.empty())
+    {
+        ok = fwrite(&m_points.front(), sizeof(AccessPoint), 
+                    m_points.size(), file) == m_points.size();
+    }
+
+    if (ok && !m_windows.empty())
+    {
+        ok = fwrite(&m_windows.front(), 1, m_windows.size(), file) == 
+             m_windows.size();
+    }
+
+    if (fclose(file) != 0) ok = false;
+    return ok || fail(std::string("can't write ") + indexFile);
+}
+
+bool
+GzipIndex::read(const char* indexFile)
+{
+    m_points.clear();
+    m_windows.clear();
+
+    FILE* file = fopen(indexFile, "rb");
+    if (!file) return fail(std::string("can't read ") + indexFile);
+
+    //
+    //  The counts in the header have to account for exactly the rest
+    //  of the file before anything is allocated for them
+    //
+
+    bool ok = fseeko(file, 0, SEEK_END) == 0;
+    off_t end = ftello(file);
+
+    GzipIndexHeader header;
+    ok = ok && end >= off_t(sizeof(header)) &&
+         fseeko(file, 0, SEEK_SET) == 0 &&
+         fread(&header, sizeof(header), 1, file) == 1 &&
+         header.magic == GzipIndexHeader::Magic &&
+         header.version == GzipIndexHeader::Version;
+
+    if (ok)
+    {
+        uint64 rest = uint64(end) - sizeof(header);
+
+        ok = header.numPoints <= rest / sizeof(AccessPoint) &&
+             header.numWindows == 
+                 (rest - header.numPoints * sizeof(AccessPoint)) / WindowSize &&
+             (rest - header.numPoints * sizeof(AccessPoint)) % WindowSize == 0;
+    }
+
+    if (ok)
+    {
+        m_points.resize(size_t(header.numPoints));
+        m_windows.resize(size_t(header.numWindows) * WindowSize);
+
+        ok = (m_points.empty() ||
+              fread(&m_points.front(), sizeof(AccessPoint), 
+                    m_points.size(), file) == m_points.size()) &&
+             (m_windows.empty() ||
+              fread(&m_windows.front(), 1, m_windows.size(), file) == 
+              m_windows.size());
+    }
+
+    fclose(file);
+
+    for (size_t i = 0; ok && i < m_points.size(); i++)
+    {
+        const AccessPoint& p = m_points[i];
+        ok = (p.bits == MemberStart || (p.bits < 8 && p.window < header.numWindows)) &&
+             (i == 0 || p.out >= m_points[i-1].out);
+    }
+
+    if (!ok)
+    {
+        m_points.clear();
+        m_windows.clear();
+        return fail(std::string("bad gzip index ") + indexFile);
+    }
+
+    m_compressedSize   = header.compressedSize;
+    m_uncompressedSize = header.uncompressedSize;
+    memcpy(m_trailer, header.trailer, sizeof(m_trailer));
+    return true;
+}
+
+#ifdef GTO_SUPPORT_ZIP
+
+bool
+GzipIndex::build(const char* filename, size_t span)
+{
+    m_points.clear();
+    m_windows.clear();
+    m_why = "";
+
+    if (!readTrailer(filename, m_compressedSize, m_trailer))
+    {
+        return fail(std::string("can't read ") + filename);
+    }
+
+    FILE* file = fopen(filename, "rb");
+    if (!file) return fail(std::string("can't read ") + filename);
+
+    z_stream z;
+    memset(&z, 0, sizeof(z));
+
+    if (inflateInit2(&z, 31) != Z_OK)
+    {
+        fclose(file);
+        return fail("inflateInit2 failed");
+    }
+
+    //
+    //  The output goes round and round through the window. Z_BLOCK
+    //  stops inflate() at each deflate block boundary, which is where
+    //  an access point can go.
+    //
+
+    vector<unsigned char> input(64 * 1024);
+    vector<unsigned char> window(WindowSize);
+    uint64                totalIn  = 0;
+    uint64                totalOut = 0;
+    uint64                last     = 0;
+    bool                  member   = true;  // at the start of a member
+    bool                  ok       = true;
+
+    while (ok)
+    {
+        if (z.avail_in == 0)
+        {
+            size_t n = fread(&input.front(), 1, input.size(), file);
+
+            if (n == 0)
+            {
+                ok = member || fail(std::string("truncated gzip file ") + filename);
+                break;
+            }
+
+            z.next_in  = &input.front();
+            z.avail_in = uInt(n);
+        }
+
+        if (member)
+        {
+            AccessPoint p;
+            p.out    = totalOut;
+            p.in     = totalIn;
+            p.bits   = MemberStart;
+            p.window = uint32(-1);
+            m_points.push_back(p);
+            last   = totalOut;
+            member = false;
+        }
+
+        if (z.avail_out == 0)
+        {
+            z.next_out  = &window.front();
+            z.avail_out = WindowSize;
+        }
+
+        totalIn  += z.avail_in;
+        totalOut += z.avail_out;
+        int status = ::inflate(&z, Z_BLOCK);
+        totalIn  -= z.avail_in;
+        totalOut -= z.avail_out;
+
+        if (status == Z_STREAM_END)
+        {
+            inflateReset(&z);
+            member = true;
+        }
+        else if (status != Z_OK && status != Z_BUF_ERROR)
+        {
+            //
+            //  Junk after the last member is ignored like gzread() does
+            //
+
+            if (m_points.size() > 1 && 
+                m_points.back().bits == MemberStart &&
+                m_points.back().out == totalOut)
+            {
+                m_points.pop_back();
+            }
+            else
+            {
+                ok = fail(std::string("bad gzip data in ") + filename);
+            }
+
+            break;
+        }
+        else if ((z.data_type & 128) && !(z.data_type & 64) && 
+                 totalOut - last >= span)
+        {
+            AccessPoint p;
+            p.out    = totalOut;
+            p.in     = totalIn;
+            p.bits   = z.data_type & 7;
+            p.window = uint32(m_windows.size() / WindowSize);
+            m_points.push_back(p);
+
+            size_t left = z.avail_out;
+            m_windows.insert(m_windows.end(), 
+                             window.begin() + (WindowSize - left), window.end());
+            m_windows.insert(m_windows.end(), 
+                             window.begin(), window.begin() + (WindowSize - left));
+            last = totalOut;
+        }
+    }
+
+    inflateEnd(&z);
+    fclose(file);
+
+    m_uncompressedSize = totalOut;
+    return ok;
+}
+
+//----------------------------------------------------------------------
+
+IndexedGzipFile::IndexedGzipFile()
+    : m_file(0),
+      m_stream(0),
+      m_raw(false),
+      m_member(false),
+      m_eof(false),
+      m_trailer(0),
+      m_pos(0),
+      m_streamPos(0),
+      m_outPos(0),
+      m_outEnd(0)
+{
+}
+
+IndexedGzipFile::~IndexedGzipFile()
+{
+    close();
+}
+
+bool
+IndexedGzipFile::fail(const std::string& why)
+{
+    if (m_why.empty()) m_why = why;
+    m_eof = true;
+    return false;
+}
+
+bool
+IndexedGzipFile::open(const char* filename)
+{
+    close();
+
+    if (!m_index.read(GzipIndex::indexName(filename).c_str()) ||
+        !m_index.numPoints() ||
+        !m_index.matches(filename))
+    {
+        return false;
+    }
+
+    m_file = fopen(filename, "rb");
+    if (!m_file) return false;
+
+    z_stream* z = new z_stream;
+    memset(z, 0, sizeof(z_stream));
+    m_stream = z;
+    m_input.resize(64 * 1024);
+    m_output.resize(64 * 1024);
+    return start(m_index.point(0));
+}
+
+void
+IndexedGzipFile::close()
+{
+    if (z_stream* z = (z_stream*)m_stream)
+    {
+        if (z->state) inflateEnd(z);
+        delete z;
+    }
+
+    if (m_file) fclose(m_file);
+    m_file   = 0;
+    m_stream = 0;
+    m_why    = "";
+}
+
+bool
+IndexedGzipFile::start(const GzipIndex::AccessPoint& p)
+{
+    z_stream* z = (z_stream*)m_stream;
+    if (z->state) inflateEnd(z);
+    memset(z, 0, sizeof(z_stream));
+
+    m_eof       = false;
+    m_trailer   = 0;
+    m_outPos    = 0;
+    m_outEnd    = 0;
+    m_pos       = p.out;
+    m_streamPos = p.out;
+
+    if (p.bits == GzipIndex::MemberStart)
+    {
+        if (fseeko(m_file, off_t(p.in), SEEK_SET) != 0 ||
+            inflateInit2(z, 31) != Z_OK)
+        {
+            return fail("can't start inflating");
+        }
+
+        m_raw    = false;
+        m_member = true;
+        return true;
+    }
+
+    //
+    //  The access point may be in the middle of a byte: the bits
+    //  left over in the byte before it are primed first
+    //
+
+    int c = 0;
+
+    if (fseeko(m_file, off_t(p.in - (p.bits ? 1 : 0)), SEEK_SET) != 0 ||
+        (p.bits && (c = getc(m_file)) == EOF) ||
+        inflateInit2(z, -15) != Z_OK ||
+        (p.bits && inflatePrime(z, p.bits, c >> (8 - p.bits)) != Z_OK) ||
+        inflateSetDictionary(z, m_index.window(p), GzipIndex::WindowSize) != Z_OK)
+    {
+        return fail("can't start inflating at an access point");
+    }
+
+    m_raw    = true;
+    m_member = false;
+    return true;
+}
+
+size_t
+IndexedGzipFile::inflateTo(char* buffer, size_t size)
+{
+    z_stream* z = (z_stream*)m_stream;
+    size_t    n = 0;
+
+    while (n < size && !m_eof)
+    {
+        if (z->avail_in == 0)
+        {
+            size_t got = fread(&m_input.front(), 1, m_input.size(), m_file);
+
+            if (got == 0)
+            {
+                m_eof = true;
+                break;
+            }
+
+            z->next_in  = (Bytef*)&m_input.front();
+            z->avail_in = uInt(got);
+        }
+
+        if (m_trailer)
+        {
+            //
+            //  A deflate stream started from an access point ends
+            //  before the member's gzip trailer
+            //
+
+            size_t skip  = std::min(m_trailer, size_t(z->avail_in));
+            z->next_in  += skip;
+            z->avail_in -= uInt(skip);
+            m_trailer   -= skip;
+
+            if (!m_trailer)
+            {
+                inflateReset2(z, 31);
+                m_raw    = false;
+                m_member = true;
+            }
+
+            continue;
+        }
+
+        uInt chunk   = uInt(std::min(size - n, size_t(1 << 30)));
+        z->next_out  = (Bytef*)buffer + n;
+        z->avail_out = chunk;
+
+        int    status   = ::inflate(z, Z_NO_FLUSH);
+        size_t produced = chunk - z->avail_out;
+        n += produced;
+        if (produced) m_member = false;
+
+        if (status == Z_STREAM_END)
+        {
+            if (m_raw) 
+            {
+                m_trailer = 8;
+            }
+            else
+            {
+                inflateReset(z);
+                m_member = true;
+            }
+        }
+        else if (status == Z_BUF_ERROR && !produced && z->avail_in)
+        {
+            fail("gzip inflate stalled");
+        }
+        else if (status != Z_OK && status != Z_BUF_ERROR)
+        {
+            //
+            //  Junk after the last member is the end of the file
+            //
+
+            if (m_member) m_eof = true;
+            else fail("bad gzip data");
+        }
+    }
+
+    m_streamPos += n;
+    return n;
+}
+
+size_t
+IndexedGzipFile::read(void* buffer, size_t size)
+{
+    char*  out = (char*)buffer;
+    size_t n   = 0;
+
+    while (n < size)
+    {
+        if (m_outPos == m_outEnd)
+        {
+            if (size - n >= m_output.size())
+            {
+                //
+                //  Large reads skip the buffer
+                //
+
+                size_t count = inflateTo(out + n, size - n);
+                n     += count;
+                m_pos += count;
+                break;
+            }
+
+            m_outPos = 0;
+            m_outEnd = inflateTo(&m_output.front(), m_output.size());
+            if (!m_outEnd) break;
+        }
+
+        size_t count = std::min(m_outEnd - m_outPos, size - n);
+        memcpy(out + n, &m_output[m_outPos], count);
+        m_outPos += count;
+        n        += count;
+        m_pos    += count;
+    }
+
+    return n;
+}
+
+int
+IndexedGzipFile::get()
+{
+    if (m_outPos < m_outEnd)
+    {
+        m_pos++;
+        return (unsigned char)m_output[m_outPos++];
+    }
+
+    char c;
+    return read(&c, 1) == 1 ? (unsigned char)c : -1;
+}
+
+const char*
+IndexedGzipFile::peek(size_t& available)
+{
+    if (m_outPos == m_outEnd)
+    {
+        m_outPos = 0;
+        m_outEnd = inflateTo(&m_output.front(), m_output.size());
+    }
+
+    available = m_outEnd - m_outPos;
+    return available ? &m_output[m_outPos] : 0;
+}
+
+bool
+IndexedGzipFile::seek(uint64 offset)
+{
+    if (offset >= m_pos && offset - m_pos <= uint64(m_outEnd - m_outPos))
+    {
+        m_outPos += size_t(offset - m_pos);
+        m_pos     = offset;
+        return true;
+    }
+
+    //
+    //  Inflate forward from where the stream is unless there's an
+    //  access point in between
+    //
+
+    const GzipIndex::AccessPoint* p = m_index.find(offset);
+    if (!p) return false;
+
+    m_outPos = 0;
+    m_outEnd = 0;
+
+    if (offset < m_streamPos || p->out > m_streamPos)
+    {
+        if (!start(*p)) return false;
+    }
+
+    while (m_streamPos < offset)
+    {
+        size_t count = size_t(std::min(offset - m_streamPos, 
+                                       uint64(m_output.size())));
+        if (!inflateTo(&m_output.front(), count)) break;
+    }
+
+    m_pos = m_streamPos;
+    return m_pos == offset;
+}
+
+#else
+
+bool
+GzipIndex::build(const char*, size_t)
+{
+    return fail("not compiled with zlib support");
+}
+
+IndexedGzipFile::IndexedGzipFile() 
+    : m_file(0), m_stream(0), m_raw(false), m_member(false), m_eof(false),
+      m_trailer(0), m_pos(0), m_streamPos(0), m_outPos(0), m_outEnd(0) {}
+IndexedGzipFile::~IndexedGzipFile() {}
+bool IndexedGzipFile::open(const char*) { return false; }
+void IndexedGzipFile::close() {}
+size_t IndexedGzipFile::read(void*, size_t) { return 0; }
+int IndexedGzipFile::get() { return -1; }
+const char* IndexedGzipFile::peek(size_t& n) { n = 0; return 0; }
+bool IndexedGzipFile::seek(uint64) { return false; }
+
+#endif
+
+} // Gto
@@ -0,0 +1,283 @@
+//
+//  Copyright (c) 2009, Tweak Software
+//  All rights reserved.
+// 
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//
+//     * Redistributions of source code must retain the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials
+//       provided with the distribution.
+//
+//     * Neither the name of the Tweak Software nor the names of its
+//       contributors may be used to endorse or promote products
+//       derived from this software without specific prior written
+//       permission.
+// 
+//  THIS SOFTWARE IS PROVIDED BY Tweak Software ''AS IS'' AND ANY EXPRESS
+//  OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL Tweak Software BE LIABLE FOR
+//  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+//  OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+//  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+//  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+//  USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+//  DAMAGE.
+
+#ifndef __Gto__Codec__h__
+#define __Gto__Codec__h__
+#include <Gto/Header.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+namespace Gto {
+
+//
+//  class Codec
+//
+//  Compresses and decompresses the blocks of a block compressed file
+//  (see Header.h). Each codec has a BlockCodec id which is stored in
+//  the BlockHeader so the Reader can pick the right one when the file
+//  is opened. Which codecs are available depends on the libraries the
+//  library was built with (GTO_SUPPORT_ZIP, GTO_SUPPORT_LZ4 and
+//  GTO_SUPPORT_ZSTD). NoCodec is always available.
+//
+//  Other codecs can be added with registerCodec(). The codec must
+//  outlive any Reader or Writer using it. Codecs are called from the
+//  Reader's worker threads so compress() and decompress() should not
+//  modify the codec.
+//
+
+class Codec
+{
+public:
+    virtual ~Codec();
+
+    virtual uint32      id() const = 0;
+    virtual const char* name() const = 0;
+
+    //
+    //  Largest possible output of compress() for size bytes of input
+    //
+
+    virtual size_t      compressBound(size_t size) const = 0;
+
+    //
+    //  outSize is the size of out on input and the number of bytes
+    //  written on output.
+    //
+
+    virtual bool        compress(const char* in, size_t inSize,
+                                 char* out, size_t& outSize) const = 0;
+
+    //
+    //  outSize is the exact decompressed size: anything else is an
+    //  error.
+    //
+
+    virtual bool        decompress(const char* in, size_t inSize,
+                                   char* out, size_t outSize) const = 0;
+
+    //
+    //  Returns 0 if the codec is not available.
+    //
+
+    static const Codec* find(uint32 id);
+    static void         registerCodec(const Codec*);
+};
+
+//
+//  class CompressedFile
+//
+//  A gzip file (CompressedGTO) opened with zlib's gz* API. All of the
+//  dependencies on zlib's stream API are in here so the Reader and
+//  Writer don't have to care whether it was compiled in. If it
+//  wasn't, open() always fails and supported() returns false.
+//
+
+class CompressedFile
+{
+public:
+    CompressedFile();
+    ~CompressedFile();
+
+    static bool         supported();
+
+    bool                open(const char* filename, const char* mode);
+    void                close();
+    bool                isOpen() const { return m_file != 0; }
+
+    //
+    //  read() returns the number of bytes read which is less than size
+    //  at the end of the file or on error. get() returns -1 at the end
+    //  of the file. Offsets are in uncompressed bytes.
+    //
+
+    size_t              read(void*, size_t size);
+    int                 get();
+    bool                write(const void*, size_t size);
+
+    bool                seek(int64 offset, int whence);
+    int64               tell();
+    std::string         error();
+
+    //
+    //  True if the file being read isn't compressed at all (gzopen()
+    //  reads plain files too). Only meaningful after the first read.
+    //
+
+    bool                direct();
+
+private:
+    void*               m_file;
+};
+
+//
+//  class GzipIndex
+//
+//  Access points into a gzip file (as in zlib's zran example) so it
+//  can be read from the middle without inflating everything in front
+//  of it. Roughly every span uncompressed bytes the inflate state is
+//  recorded: the bit position in the compressed data and the last 32K
+//  of output. The start of each gzip member is an access point too,
+//  which needs no window; files written by a Writer with more than one
+//  thread have one every chunk.
+//
+//  The index is kept next to the file it describes (see indexName())
+//  and is used by the Reader in RandomAccess mode. It records the size
+//  and gzip trailer of the file so a stale index is ignored.
+//
+
+class GzipIndex
+{
+public:
+    struct AccessPoint
+    {
+        uint64          out;        // uncompressed offset
+        uint64          in;         // compressed offset
+        uint32          bits;       // unused bits before in (8 for a member start)
+        uint32          window;     // index of the window or -1
+    };
+
+    enum { WindowSize = 32768, MemberStart = 8 };
+
+    static const size_t DefaultSpan = 4 * 1024 * 1024;
+
+    GzipIndex();
+
+    static std::string  indexName(const char* filename);
+
+    //
+    //  build() inflates the whole file. Returns false and sets why()
+    //  if the file can't be read or isn't gzipped.
+    //
+
+    bool                build(const char* filename, size_t span = DefaultSpan);
+    bool                write(const char* indexFile);
+    bool                read(const char* indexFile);
+
+    //
+    //  Checks that the index belongs to the file
+    //
+
+    bool                matches(const char* filename);
+
+    uint64              uncompressedSize() const { return m_uncompressedSize; }
+    size_t              numPoints() const { return m_points.size(); }
+    const AccessPoint&  point(size_t i) const { return m_points[i]; }
+    const unsigned char* window(const AccessPoint& p) const
+                        { return &m_windows[size_t(p.window) * WindowSize]; }
+
+    //
+    //  The last access point at or before offset
+    //
+
+    const AccessPoint*  find(uint64 offset) const;
+
+    const std::string&  why() const { return m_why; }
+
+private:
+    bool                fail(const std::string&);
+    bool                readTrailer(const char* filename, uint64& size, 
+                                    unsigned char* trailer);
+
+private:
+    std::vector<AccessPoint>    m_points;
+    std::vector<unsigned char>  m_windows;
+    uint64                      m_compressedSize;
+    uint64                      m_uncompressedSize;
+    unsigned char               m_trailer[8];
+    std::string                 m_why;
+};
+
+//
+//  class IndexedGzipFile
+//
+//  Reads a gzip file using a GzipIndex. Seeking starts inflating at
+//  the nearest access point in front of the target instead of at the
+//  start of the file.
+//
+
+class IndexedGzipFile
+{
+public:
+    IndexedGzipFile();
+    ~IndexedGzipFile();
+
+    //
+    //  Fails if there is no index for the file or it doesn't match
+    //
+
+    bool                open(const char* filename);
+    void                close();
+
+    size_t              read(void*, size_t size);
+    int                 get();
+
+    //
+    //  Returns the buffered output at the current position without
+    //  consuming it (available is 0 at the end of the file).
+    //
+
+    const char*         peek(size_t& available);
+
+    bool                seek(uint64 offset);
+    uint64              tell() const { return m_pos; }
+    uint64              size() const { return m_index.uncompressedSize(); }
+    const std::string&  error() const { return m_why; }
+
+private:
+    bool                start(const GzipIndex::AccessPoint&);
+    size_t              inflateTo(char*, size_t size);
+    bool                fail(const std::string&);
+
+private:
+    GzipIndex           m_index;
+    FILE*               m_file;
+    void*               m_stream;
+    bool                m_raw;      // inflating from an access point
+    bool                m_member;   // nothing inflated since a member started
+    bool                m_eof;
+    size_t              m_trailer;  // gzip trailer bytes left to skip
+    uint64              m_pos;
+    uint64              m_streamPos;
+    std::vector<char>   m_input;
+    std::vector<char>   m_output;   // holds [m_pos, m_streamPos)
+    size_t              m_outPos;
+    size_t              m_outEnd;
+    std::string         m_why;
+};
+
+} // Gto
+
+#endif // __Gto__Codec__h__
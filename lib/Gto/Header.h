@@ -56,6 +56,12 @@ namespace Gto {
 #define GTO_MAGIC_TEXTl 0x614f5447
 #define GTO_VERSION     4
 
+#define GTO_MAGIC_BLOCK  0x47544f62
+#define GTO_MAGIC_BLOCKl 0x624f5447
+#define GTO_BLOCK_VERSION 1
+
+typedef unsigned long long  uint64;
+typedef long long           int64;
 typedef unsigned int        uint32;
 typedef int                 int32;
 typedef unsigned short      uint16;
@@ -92,6 +98,35 @@ struct Header
     uint32        flags;                    // undetermined;
 };
 
+//
+//  Header flags. Bit 0 is set in the headers the Reader makes up for
+//  text files, so it isn't used here.
+//
+
+enum HeaderFlags
+{
+    HeaderAtEnd = 1 << 1,       // see Footer
+};
+
+//
+//  Streamed files
+//
+//  A Writer in streaming mode writes property data as soon as the
+//  property is declared so it can't know the contents of the header
+//  ahead of time. The Header at the start of a streamed file has the
+//  HeaderAtEnd flag set and no strings or objects. The property data
+//  follows it, then a complete header (Header, string table, objects,
+//  components and properties as usual) and finally the Footer which
+//  holds the offset of that header from the start of the file.
+//
+
+struct Footer
+{
+    uint64        headerOffset;
+    uint32        flags;                    // undetermined
+    uint32        magic;                    // GTO_MAGIC
+};
+
 //
 //  Object Header
 //
@@ -158,6 +193,28 @@ enum DataType
     ErrorType
 };
 
+//
+//  Property filters are reversible transforms applied to property
+//  data before it's written to make it compress better. They're
+//  recorded in the top byte of PropertyHeader::type. The data is
+//  filtered in GTO_FILTER_BLOCK byte pieces so any piece can be
+//  decoded by itself. Files with filtered properties can't be read by
+//  versions of the library which predate them.
+//
+
+#define GTO_FILTER_SHIFT    24
+#define GTO_TYPE_MASK       0x00ffffff
+#define GTO_FILTER_BLOCK    (64 * 1024)
+
+enum PropertyFilter
+{
+    NoFilter        = 0,
+    ShuffleFilter   = 1 << 0,   // group the bytes of each value by significance
+    DeltaFilter     = 1 << 1,   // store differences of successive integers
+
+    AllFilters      = ShuffleFilter | DeltaFilter
+};
+
 struct PropertyHeader
 {
     PropertyHeader() : dims(0,0,0,0) {}
@@ -186,6 +243,61 @@ struct PropertyHeader_v2
     uint32        width;
 };
 
+//
+//  Block Compressed Files
+//
+//  A block compressed file wraps an ordinary binary GTO file (the
+//  "logical" file). The logical file is cut into blocks of blockSize
+//  bytes which are compressed independently and stored one after
+//  another following the BlockHeader. The block index and trailer
+//  are written at the end of the file. The trailer has a fixed size
+//  so a reader can find the index by seeking to the end of the file.
+//
+//  A property at logical offset N is found in block N / blockSize so
+//  random access only needs to decompress the blocks the property
+//  covers.
+//
+//  The codec used for the blocks is recorded in the BlockHeader (see
+//  Codec.h). Ids below 256 are reserved for the library.
+//
+
+enum BlockCodec
+{
+    NoCodec,            // stored
+    ZlibCodec,          // zlib compress()
+    Lz4Codec,           // LZ4 block format
+    ZstdCodec,          // Zstandard frame
+
+    NumberOfCodecs
+};
+
+struct BlockHeader
+{
+    static const unsigned int Magic = GTO_MAGIC_BLOCK;
+    static const unsigned int Cigam = GTO_MAGIC_BLOCKl;
+
+    uint32        magic;
+    uint32        version;
+    uint32        codec;
+    uint32        blockSize;        // logical bytes per block
+};
+
+struct BlockIndexEntry
+{
+    uint64        offset;           // file offset of compressed block
+    uint32        compressedSize;
+    uint32        size;             // logical bytes in block
+};
+
+struct BlockTrailer
+{
+    uint64        indexOffset;      // file offset of first index entry
+    uint64        numBlocks;
+    uint64        size;             // total logical bytes
+    uint32        flags;            // undetermined
+    uint32        magic;
+};
+
 } // Gto
 
 #endif // __Gto__Header__h__
@@ -0,0 +1,245 @@
+//
+//  Copyright (c) 2009, Tweak Software
+//  All rights reserved.
+// 
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//
+//     * Redistributions of source code must retain the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials
+//       provided with the distribution.
+//
+//     * Neither the name of the Tweak Software nor the names of its
+//       contributors may be used to endorse or promote products
+//       derived from this software without specific prior written
+//       permission.
+// 
+//  THIS SOFTWARE IS PROVIDED BY Tweak Software ''AS IS'' AND ANY EXPRESS
+//  OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL Tweak Software BE LIABLE FOR
+//  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+//  OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+//  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+//  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+//  USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+//  DAMAGE.
+
+#include "IoRing.h"
+#include <string.h>
+#include <unistd.h>
+#ifdef GTO_SUPPORT_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <errno.h>
+#endif
+
+//
+//  Older C libraries don't know the system call numbers
+//
+
+#if defined(GTO_SUPPORT_IO_URING) && !defined(__NR_io_uring_setup)
+#undef GTO_SUPPORT_IO_URING
+#endif
+
+namespace Gto {
+using namespace std;
+
+#ifdef GTO_SUPPORT_IO_URING
+
+//
+//  The rings are shared with the kernel. The head and tail indices
+//  need acquire/release ordering so the entries are seen before the
+//  index which publishes them.
+//
+
+static inline unsigned int
+loadAcquire(const unsigned int* p)
+{
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+static inline void
+storeRelease(unsigned int* p, unsigned int v)
+{
+    __atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+
+static inline unsigned int*
+ringField(void* ring, unsigned int offset)
+{
+    return reinterpret_cast<unsigned int*>((char*)ring + offset);
+}
+
+IoRing::IoRing(unsigned int entries)
+    : m_fd(-1),
+      m_entries(0),
+      m_queued(0),
+      m_sqRing(MAP_FAILED),
+      m_sqRingSize(0),
+      m_cqRing(MAP_FAILED),
+      m_cqRingSize(0),
+      m_sqes(MAP_FAILED),
+      m_sqesSize(0)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    int fd = int(syscall(__NR_io_uring_setup, entries, &params));
+    if (fd < 0) return;
+
+    m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    m_cqRingSize = params.cq_off.cqes + 
+                   params.cq_entries * sizeof(struct io_uring_cqe);
+    m_sqesSize   = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single && m_cqRingSize > m_sqRingSize) m_sqRingSize = m_cqRingSize;
+
+    m_sqRing = mmap(0, m_sqRingSize, PROT_READ|PROT_WRITE, 
+                    MAP_SHARED|MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+
+    if (single)
+    {
+        m_cqRing     = m_sqRing;
+        m_cqRingSize = 0;
+    }
+    else
+    {
+        m_cqRing = mmap(0, m_cqRingSize, PROT_READ|PROT_WRITE, 
+                        MAP_SHARED|MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    }
+
+    m_sqes = mmap(0, m_sqesSize, PROT_READ|PROT_WRITE, 
+                  MAP_SHARED|MAP_POPULATE, fd, IORING_OFF_SQES);
+
+    if (m_sqRing == MAP_FAILED || m_cqRing == MAP_FAILED || 
+        m_sqes == MAP_FAILED)
+    {
+        m_fd = fd;
+        release();
+        return;
+    }
+
+    m_sqHead  = ringField(m_sqRing, params.sq_off.head);
+    m_sqTail  = ringField(m_sqRing, params.sq_off.tail);
+    m_sqMask  = ringField(m_sqRing, params.sq_off.ring_mask);
+    m_sqArray = ringField(m_sqRing, params.sq_off.array);
+    m_cqHead  = ringField(m_cqRing, params.cq_off.head);
+    m_cqTail  = ringField(m_cqRing, params.cq_off.tail);
+    m_cqMask  = ringField(m_cqRing, params.cq_off.ring_mask);
+    m_cqes    = (char*)m_cqRing + params.cq_off.cqes;
+    m_entries = params.sq_entries;
+    m_fd      = fd;
+}
+
+IoRing::~IoRing()
+{
+    release();
+}
+
+void
+IoRing::release()
+{
+    if (m_sqes != MAP_FAILED) munmap(m_sqes, m_sqesSize);
+    if (m_cqRing != MAP_FAILED && m_cqRingSize) munmap(m_cqRing, m_cqRingSize);
+    if (m_sqRing != MAP_FAILED) munmap(m_sqRing, m_sqRingSize);
+    if (m_fd != -1) ::close(m_fd);
+
+    m_sqes   = MAP_FAILED;
+    m_cqRing = MAP_FAILED;
+    m_sqRing = MAP_FAILED;
+    m_fd     = -1;
+}
+
+bool
+IoRing::read(int fd, void* buffer, size_t bytes, uint64 offset, uint64 userData)
+{
+    unsigned int tail = *m_sqTail;
+    if (tail - loadAcquire(m_sqHead) >= m_entries) return false;
+
+    unsigned int index = tail & *m_sqMask;
+    struct io_uring_sqe* sqe = (struct io_uring_sqe*)m_sqes + index;
+
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    sqe->opcode    = IORING_OP_READ;
+    sqe->fd        = fd;
+    sqe->off       = offset;
+    sqe->addr      = (unsigned long)buffer;
+    sqe->len       = (unsigned int)bytes;
+    sqe->user_data = userData;
+
+    m_sqArray[index] = index;
+    storeRelease(m_sqTail, tail + 1);
+    m_queued++;
+    return true;
+}
+
+bool
+IoRing::submit()
+{
+    while (m_queued)
+    {
+        int n = int(syscall(__NR_io_uring_enter, m_fd, m_queued, 0, 0, 0, 0));
+
+        if (n < 0)
+        {
+            if (errno == EINTR || errno == EAGAIN) continue;
+            return false;
+        }
+
+        m_queued -= n;
+    }
+
+    return true;
+}
+
+bool
+IoRing::wait(uint64& userData, int& result)
+{
+    if (!submit()) return false;
+
+    while (true)
+    {
+        unsigned int head = *m_cqHead;
+
+        if (head != loadAcquire(m_cqTail))
+        {
+            struct io_uring_cqe* cqe = 
+                (struct io_uring_cqe*)m_cqes + (head & *m_cqMask);
+
+            userData = cqe->user_data;
+            result   = cqe->res;
+            storeRelease(m_cqHead, head + 1);
+            return true;
+        }
+
+        int n = int(syscall(__NR_io_uring_enter, m_fd, 0, 1, 
+                            IORING_ENTER_GETEVENTS, 0, 0));
+
+        if (n < 0 && errno != EINTR && errno != EAGAIN) return false;
+    }
+}
+
+#else
+
+IoRing::IoRing(unsigned int) 
+    : m_fd(-1), m_entries(0), m_queued(0) {}
+IoRing::~IoRing() {}
+void IoRing::release() {}
+bool IoRing::read(int, void*, size_t, uint64, uint64) { return false; }
+bool IoRing::submit() { return false; }
+bool IoRing::wait(uint64&, int&) { return false; }
+
+#endif
+
+} // Gto
@@ -0,0 +1,112 @@
+//
+//  Copyright (c) 2009, Tweak Software
+//  All rights reserved.
+// 
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//
+//     * Redistributions of source code must retain the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials
+//       provided with the distribution.
+//
+//     * Neither the name of the Tweak Software nor the names of its
+//       contributors may be used to endorse or promote products
+//       derived from this software without specific prior written
+//       permission.
+// 
+//  THIS SOFTWARE IS PROVIDED BY Tweak Software ''AS IS'' AND ANY EXPRESS
+//  OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL Tweak Software BE LIABLE FOR
+//  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+//  OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+//  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+//  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+//  USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+//  DAMAGE.
+
+#ifndef __Gto__IoRing__h__
+#define __Gto__IoRing__h__
+#include <Gto/Header.h>
+#include <sys/types.h>
+
+namespace Gto {
+
+//
+//  class IoRing
+//
+//  A minimal io_uring submission/completion queue used internally by
+//  the Reader to keep many reads in flight at once. Talks to the
+//  kernel directly through the io_uring system calls so no extra
+//  library is needed.
+//
+//  If the library is compiled without GTO_SUPPORT_IO_URING, or the
+//  kernel refuses to set up a ring, good() returns false and the
+//  caller should fall back to ordinary reads.
+//
+
+class IoRing
+{
+public:
+    explicit IoRing(unsigned int entries = 64);
+    ~IoRing();
+
+    bool            good() const { return m_fd != -1; }
+    unsigned int    capacity() const { return m_entries; }
+
+    //
+    //  Queues a read of bytes at offset of fd into buffer. userData
+    //  comes back with the completion. Returns false if the
+    //  submission queue is full. Reads are passed to the kernel by
+    //  submit() or wait().
+    //
+
+    bool            read(int fd, 
+                         void* buffer, 
+                         size_t bytes, 
+                         uint64 offset, 
+                         uint64 userData);
+
+    bool            submit();
+
+    //
+    //  Waits for the next completion. result is the number of bytes
+    //  read or a negative errno.
+    //
+
+    bool            wait(uint64& userData, int& result);
+
+private:
+    void            release();
+
+private:
+    int             m_fd;
+    unsigned int    m_entries;
+    unsigned int    m_queued;       // queued but not yet submitted
+    void*           m_sqRing;
+    size_t          m_sqRingSize;
+    void*           m_cqRing;
+    size_t          m_cqRingSize;
+    void*           m_sqes;
+    size_t          m_sqesSize;
+    unsigned int*   m_sqHead;
+    unsigned int*   m_sqTail;
+    unsigned int*   m_sqMask;
+    unsigned int*   m_sqArray;
+    unsigned int*   m_cqHead;
+    unsigned int*   m_cqTail;
+    unsigned int*   m_cqMask;
+    void*           m_cqes;
+};
+
+} // Gto
+
+#endif // __Gto__IoRing__h__
@@ -52,10 +52,6 @@
 #include "Utilities.h"
 #include <stdarg.h>
 
-#ifdef GTO_SUPPORT_HALF
-#include <half.h>
-#endif
-
 int  yylex(void*, void*);
 void GTOParseError(void*, const char *,...);
 void GTOParseWarning(void*, const char *,...);
@@ -485,18 +481,11 @@ numeric_value:
               READER->addToPropertyBuffer(double($1));
               break;
 
-#ifdef GTO_SUPPORT_HALF
           case Gto::Half:
               $$.type = Gto::Half;
               $$._double = $1;
-              READER->addToPropertyBuffer(half($1));
+              READER->addToPropertyBuffer(Gto::floatToHalf(float($1)));
               break;
-#else
-          case Gto::Half:
-              GTOParseError(state, "numeric type '%s' is currently unsupported "
-                            "by the parser", typeName(t));
-              YYERROR;
-#endif
 
           case Gto::Short:
               if ($1 != short($1))
@@ -576,20 +565,18 @@ numeric_value:
               READER->addToPropertyBuffer(double($1));
               break;
 
-#ifdef GTO_SUPPORT_HALF
           case Gto::Half:
-              if ($1 != half($1))
+              if ($1 != Gto::halfToFloat(Gto::floatToHalf(float($1))))
               {
                   GTOParseWarning(state, "integer cannot be represented "
                                   "as half (%d => %f)",
-                                  $1, float($1));
+                                  $1, Gto::halfToFloat(Gto::floatToHalf(float($1))));
               }
               
               $$.type = Gto::Half;
               $$._double = $1;
-              READER->addToPropertyBuffer(half($1));
+              READER->addToPropertyBuffer(Gto::floatToHalf(float($1)));
               break;
-#endif
 
           case Gto::Short:
               if ($1 != short($1))
@@ -361,6 +361,7 @@ RawDataBaseWriter::writeProperty(bool header, const Property *property)
               m_writer.propertyData(property->doubleData);
               break;
           case Gto::Short:
+          case Gto::Half:
               m_writer.propertyData(property->uint16Data);
               break;
           case Gto::Int:
@@ -369,7 +370,6 @@ RawDataBaseWriter::writeProperty(bool header, const Property *property)
           case Gto::Byte:
               m_writer.propertyData(property->uint8Data);
               break;
-          case Gto::Half:
           case Gto::Boolean:
           default:
               abort();    // not implemented;
@@ -0,0 +1,288 @@
+//
+//  Copyright (c) 2009, Tweak Software
+//  All rights reserved.
+// 
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//
+//     * Redistributions of source code must retain the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials
+//       provided with the distribution.
+//
+//     * Neither the name of the Tweak Software nor the names of its
+//       contributors may be used to endorse or promote products
+//       derived from this software without specific prior written
+//       permission.
+// 
+//  THIS SOFTWARE IS PROVIDED BY Tweak Software ''AS IS'' AND ANY EXPRESS
+//  OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL Tweak Software BE LIABLE FOR
+//  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+//  OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+//  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+//  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+//  USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+//  DAMAGE.
+
+#include "ReadAheadStream.h"
+#include "Codec.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+
+namespace Gto {
+using namespace std;
+
+//
+//  Fills one buffer from the source. The pool has a single thread and
+//  runs its jobs in order so the source is read sequentially.
+//
+
+struct FillJob : public ThreadPool::Job
+{
+    FillJob(istream* in, CompressedFile* gzfile, size_t bufferSize)
+        : in(in), gzfile(gzfile), data(bufferSize), start(0), size(0) {}
+
+    virtual void run()
+    {
+        if (in)
+        {
+            in->read(&data.front(), data.size());
+            size = size_t(in->gcount());
+        }
+        else
+        {
+            size = gzfile->read(&data.front(), data.size());
+        }
+    }
+
+    istream*        in;
+    CompressedFile* gzfile;
+    vector<char>    data;
+    uint64          start;      // source position of data[0]
+    size_t          size;       // bytes filled
+};
+
+ReadAheadStream::ReadAheadStream(istream* in, 
+                                 size_t bufferSize, 
+                                 size_t numBuffers)
+    : m_in(in),
+      m_gzfile(0)
+{
+    streamoff pos = in->tellg();
+    m_pos = pos > 0 ? uint64(pos) : 0;
+    init(bufferSize, numBuffers);
+}
+
+ReadAheadStream::ReadAheadStream(CompressedFile* gzfile, 
+                                 size_t bufferSize, 
+                                 size_t numBuffers)
+    : m_in(0),
+      m_gzfile(gzfile)
+{
+    int64 pos = gzfile->tell();
+    m_pos = pos > 0 ? uint64(pos) : 0;
+    init(bufferSize, numBuffers);
+}
+
+ReadAheadStream::~ReadAheadStream()
+{
+    drain();
+    for (size_t i = 0; i < m_jobs.size(); i++) delete m_jobs[i];
+    delete m_pool;
+}
+
+void
+ReadAheadStream::init(size_t bufferSize, size_t numBuffers)
+{
+    m_pool    = new ThreadPool(1);
+    m_current = 0;
+    m_end     = m_pos;
+    m_eof     = false;
+    m_failed  = false;
+
+    bufferSize = std::max(bufferSize, size_t(1));
+    numBuffers = std::max(numBuffers, size_t(2));
+
+    for (size_t i = 0; i < numBuffers; i++)
+    {
+        FillJob* job = new FillJob(m_in, m_gzfile, bufferSize);
+        m_jobs.push_back(job);
+        queue(job);
+    }
+}
+
+void
+ReadAheadStream::queue(FillJob* job)
+{
+    job->start = m_end;
+    job->size  = 0;
+    m_end     += job->data.size();
+    m_queue.push_back(job);
+    m_pool->add(job);
+}
+
+void
+ReadAheadStream::drain()
+{
+    for (size_t i = 0; i < m_queue.size(); i++)
+    {
+        m_pool->wait(m_queue[i]);
+        m_free.push_back(m_queue[i]);
+    }
+
+    m_queue.clear();
+    if (m_current) m_free.push_back(m_current);
+    m_current = 0;
+}
+
+void
+ReadAheadStream::restart()
+{
+    drain();
+
+    if (m_in)
+    {
+        m_in->clear();
+        m_in->seekg(streamoff(m_pos), ios::beg);
+    }
+    else
+    {
+        m_gzfile->seek(int64(m_pos), SEEK_SET);
+    }
+
+    m_end = m_pos;
+    m_eof = false;
+
+    for (size_t i = 0; i < m_free.size(); i++) queue(m_free[i]);
+    m_free.clear();
+}
+
+bool
+ReadAheadStream::advance()
+{
+    //
+    //  The buffer which was being consumed goes back into the ring
+    //
+
+    if (m_current)
+    {
+        if (m_eof) m_free.push_back(m_current);
+        else queue(m_current);
+        m_current = 0;
+    }
+
+    for (;;)
+    {
+        if (m_eof && m_pos >= m_end) return false;
+
+        if (m_queue.empty() || 
+            m_pos < m_queue.front()->start || 
+            m_pos >= m_end)
+        {
+            restart();
+        }
+
+        FillJob* job = m_queue.front();
+        m_queue.pop_front();
+        m_pool->wait(job);
+
+        if (job->size < job->data.size() && !m_eof)
+        {
+            //
+            //  Nothing queued behind this one will find any data
+            //
+
+            m_eof = true;
+            m_end = job->start + job->size;
+        }
+
+        if (m_pos >= job->start && m_pos < job->start + job->size)
+        {
+            m_current = job;
+            return true;
+        }
+
+        //
+        //  Skipped over
+        //
+
+        if (m_eof) m_free.push_back(job);
+        else queue(job);
+    }
+}
+
+size_t
+ReadAheadStream::read(char* buffer, size_t size)
+{
+    size_t n = 0;
+
+    while (n < size)
+    {
+        if (!m_current || 
+            m_pos < m_current->start || 
+            m_pos >= m_current->start + m_current->size)
+        {
+            if (!advance())
+            {
+                m_failed = true;
+                break;
+            }
+        }
+
+        size_t offset = size_t(m_pos - m_current->start);
+        size_t count  = std::min(m_current->size - offset, size - n);
+        memcpy(buffer + n, &m_current->data[offset], count);
+        n     += count;
+        m_pos += count;
+    }
+
+    return n;
+}
+
+bool
+ReadAheadStream::get(char& c)
+{
+    if (m_current && 
+        m_pos >= m_current->start && 
+        m_pos < m_current->start + m_current->size)
+    {
+        c = m_current->data[size_t(m_pos - m_current->start)];
+        m_pos++;
+        return true;
+    }
+
+    if (read(&c, 1) == 1) return true;
+    c = 0;
+    return false;
+}
+
+const char*
+ReadAheadStream::peek(size_t& available)
+{
+    available = 0;
+
+    if (!m_current || 
+        m_pos < m_current->start || 
+        m_pos >= m_current->start + m_current->size)
+    {
+        if (!advance()) return 0;
+    }
+
+    size_t offset = size_t(m_pos - m_current->start);
+    if (offset >= m_current->size) return 0;
+    available = m_current->size - offset;
+    return &m_current->data[offset];
+}
+
+} // Gto
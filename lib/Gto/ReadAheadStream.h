@@ -0,0 +1,117 @@
+//
+//  Copyright (c) 2009, Tweak Software
+//  All rights reserved.
+// 
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//
+//     * Redistributions of source code must retain the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials
+//       provided with the distribution.
+//
+//     * Neither the name of the Tweak Software nor the names of its
+//       contributors may be used to endorse or promote products
+//       derived from this software without specific prior written
+//       permission.
+// 
+//  THIS SOFTWARE IS PROVIDED BY Tweak Software ''AS IS'' AND ANY EXPRESS
+//  OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL Tweak Software BE LIABLE FOR
+//  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+//  OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+//  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+//  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+//  USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+//  DAMAGE.
+
+#ifndef __Gto__ReadAheadStream__h__
+#define __Gto__ReadAheadStream__h__
+#include <Gto/Header.h>
+#include <sys/types.h>
+#include <deque>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace Gto {
+
+class CompressedFile;
+class ThreadPool;
+struct FillJob;
+
+//
+//  class ReadAheadStream
+//
+//  Reads a file or gzip stream sequentially on a background thread.
+//  A ring of buffers is filled in front of the caller, so I/O and
+//  decompression overlap with whatever the caller does with the data.
+//  The source is not owned and must not be touched by anyone else
+//  while the ReadAheadStream exists.
+//
+//  Seeking inside the buffered data is free. Seeking anywhere else
+//  drains the ring and restarts it at the new position. If the
+//  library is compiled without GTO_SUPPORT_PTHREADS the buffers are
+//  filled by the calling thread when they are needed.
+//
+
+class ReadAheadStream
+{
+public:
+    ReadAheadStream(std::istream*, size_t bufferSize, size_t numBuffers);
+    ReadAheadStream(CompressedFile*, size_t bufferSize, size_t numBuffers);
+    ~ReadAheadStream();
+
+    //
+    //  read() returns the number of bytes read which is less than
+    //  size at the end of the source or on error.
+    //
+
+    size_t              read(char*, size_t size);
+    bool                get(char&);
+
+    //
+    //  Returns the buffered bytes at the current position without
+    //  consuming them (available is 0 at the end of the source).
+    //
+
+    const char*         peek(size_t& available);
+
+    void                seekTo(uint64 pos) { m_pos = pos; }
+    void                seekForward(uint64 bytes) { m_pos += bytes; }
+
+    uint64              tell() const { return m_pos; }
+    bool                good() const { return !m_failed; }
+
+private:
+    void                init(size_t bufferSize, size_t numBuffers);
+    bool                advance();
+    void                restart();
+    void                drain();
+    void                queue(FillJob*);
+
+private:
+    std::istream*       m_in;
+    CompressedFile*     m_gzfile;
+    ThreadPool*         m_pool;
+    std::vector<FillJob*> m_jobs;
+    std::deque<FillJob*>  m_queue;  // being filled in source order
+    std::vector<FillJob*> m_free;
+    FillJob*            m_current;  // filled and being consumed
+    uint64              m_pos;
+    uint64              m_end;      // source position after the queue
+    bool                m_eof;      // a buffer came back short
+    bool                m_failed;
+};
+
+} // Gto
+
+#endif // __Gto__ReadAheadStream__h__
@@ -36,6 +36,12 @@
 
 #include "Reader.h"
 #include "Utilities.h"
+#include "BlockIO.h"
+#include "Codec.h"
+#include "IoRing.h"
+#include "ReadAheadStream.h"
+#include "StringPool.h"
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 #include <sys/stat.h>
@@ -43,8 +49,12 @@
 #include <string.h>
 #include <stdlib.h>
 #include <iterator>
-#ifdef GTO_SUPPORT_ZIP
-#include <zlib.h>
+#ifdef GTO_SUPPORT_MMAP
+#include <sys/mman.h>
+#endif
+#if defined(GTO_SUPPORT_MMAP) || defined(GTO_SUPPORT_IO_URING)
+#include <fcntl.h>
+#include <unistd.h>
 #endif
 
 int GTOParse(Gto::Reader*);
@@ -61,12 +71,27 @@ namespace Gto {
 using namespace std;
 
 Reader::Reader(unsigned int mode) 
-    : m_in(0), 
+    : m_stringPool(new StringPool),
+      m_objectIndex(new HashIndex),
+      m_componentIndex(new HashIndex),
+      m_propertyIndex(new HashIndex),
+      m_numBuilt(0),
+      m_in(0), 
       m_inRAM(0), 
       m_inRAMSize(0), 
       m_inRAMCurrentPos(0),
+      m_mapping(0),
+      m_mappingSize(0),
       m_gzfile(0), 
+      m_indexedGz(0),
       m_gzrval(0), 
+      m_blocks(0),
+      m_readAhead(0),
+      m_readAheadSize(4 * 1024 * 1024),
+      m_readAheadBuffers(4),
+      m_numThreads(1),
+      m_chunkBuffer(0),
+      m_chunkBufferSize(0),
       m_needsClosing(false),
       m_error(false), 
       m_mode(mode),
@@ -78,6 +103,10 @@ Reader::Reader(unsigned int mode)
 Reader::~Reader()
 {
     close();
+    delete m_stringPool;
+    delete m_objectIndex;
+    delete m_componentIndex;
+    delete m_propertyIndex;
 }
 
 bool
@@ -86,9 +115,9 @@ Reader::open(void const *pData, size_t dataSize, const char *name)
     if (m_in) return false;
     if (pData == NULL) return false;
     if (dataSize <= 0) return false;
-    if (m_in || m_gzfile) close();
+    close();
 
-    m_inRAM         = (char*)pData;
+    m_inRAM         = (const char*)pData;
     m_inRAMSize     = dataSize;
     m_inRAMCurrentPos = 0;
     m_needsClosing  = false;
@@ -103,9 +132,15 @@ Reader::open(void const *pData, size_t dataSize, const char *name)
     {
         readMagicNumber();
 
-        if (m_header.magic != Header::Magic &&
-            m_header.magic != Header::Cigam)
+        if (m_header.magic == BlockHeader::Magic ||
+            m_header.magic == BlockHeader::Cigam)
+        {
+            return readBlockGTO();
+        }
+        else if (m_header.magic != Header::Magic &&
+                 m_header.magic != Header::Cigam)
         {
+            fail( "in memory data is not a binary GTO file" );
             return false;
         }
 
@@ -116,7 +151,7 @@ Reader::open(void const *pData, size_t dataSize, const char *name)
 bool
 Reader::open(istream& i, const char *name, unsigned int ormode)
 {
-    if ((m_in && m_in != &i) || m_gzfile) close();
+    if ((m_in && m_in != &i) || m_gzfile || m_indexedGz) close();
 
     m_in            = &i;
     m_needsClosing  = false;
@@ -131,8 +166,14 @@ Reader::open(istream& i, const char *name, unsigned int ormode)
     {
         readMagicNumber();
 
-        if (m_header.magic != Header::Magic &&
-            m_header.magic != Header::Cigam)
+        if (m_header.magic == BlockHeader::Magic ||
+            m_header.magic == BlockHeader::Cigam)
+        {
+            i.seekg(-std::streamoff(sizeof(uint32)), std::ios::cur);
+            return readBlockGTO();
+        }
+        else if (m_header.magic != Header::Magic &&
+                 m_header.magic != Header::Cigam)
         {
             i.seekg(0, std::ios::beg);
             return readTextGTO();
@@ -159,46 +200,62 @@ Reader::open(const char *filename)
     m_inName = filename;
 
     //
-    //  Fail if not compiled with zlib and the extension is gz
+    //  Uncompressed binary files can be used in place if requested
     //
 
-#ifndef GTO_SUPPORT_ZIP
-    size_t i = m_inName.find(".gz", 0, 3);
-    if (i == (strlen(filename) - 3))
+    if ((m_mode & MemoryMapped) && !(m_mode & TextOnly) && mapFile(filename))
     {
-        fail( "this library was not compiled with zlib support" );
-        return false;
+        m_needsClosing = true;
+        m_error = false;
+        readMagicNumber();
+        return readBinaryGTO();
     }
-#endif
 
     //
-    //  Figure out if this is a text GTO file
+    //  Fail if not compiled with zlib and the extension is gz
     //
 
-#ifdef GTO_SUPPORT_ZIP
-    m_gzfile = gzopen(filename, "rb");
+    if (!CompressedFile::supported())
+    {
+        size_t i = m_inName.find(".gz", 0, 3);
+        if (i == (strlen(filename) - 3))
+        {
+            fail( "this library was not compiled with zlib support" );
+            return false;
+        }
+
+        m_in = new ifstream(filename, ios::in|ios::binary);
 
-    if (!m_gzfile)
+        if ( !(*m_in) )
+        {
+            delete m_in;
+            m_in = 0;
+            fail( "stream failed to open" );
+            return false;
+        }
+    }
+    else
     {
         //
-        //  Try .gz version before giving up completely
+        //  gzopen() reads uncompressed files too
         //
 
-        std::string temp(filename);
-        temp += ".gz";
-        return open(temp.c_str());
-    }
+        m_gzfile = new CompressedFile;
 
-#else
-    m_in = new ifstream(filename, ios::in|ios::binary);
-    
-    if ( !(*m_in) )
-    {
-        m_in = 0;
-        fail( "stream failed to open" );
-        return false;
+        if (!m_gzfile->open(filename, "rb"))
+        {
+            delete m_gzfile;
+            m_gzfile = 0;
+
+            //
+            //  Try .gz version before giving up completely
+            //
+
+            std::string temp(filename);
+            temp += ".gz";
+            return open(temp.c_str());
+        }
     }
-#endif
 
     m_needsClosing = true;
     m_error = false;
@@ -229,8 +286,31 @@ Reader::open(const char *filename)
         m_needsClosing = true;
         return ret;
     }
+    else if (m_header.magic == BlockHeader::Magic ||
+             m_header.magic == BlockHeader::Cigam)
+    {
+        //
+        //  Block compressed files need a seekable uncompressed stream
+        //
+
+        close();
+        m_in = new ifstream(filename, ios::in|ios::binary);
+
+        if ( !(*m_in) )
+        {
+            delete m_in;
+            m_in = 0;
+            fail( "stream failed to open" );
+            return false;
+        }
+
+        m_inName       = filename;
+        m_needsClosing = true;
+        return readBlockGTO();
+    }
     else
     {
+        if (m_mode & RandomAccess) openGzipIndex();
         return readBinaryGTO();
     }
 }
@@ -238,6 +318,11 @@ Reader::open(const char *filename)
 void
 Reader::close()
 {
+    unmapFile();
+    delete m_readAhead;
+    m_readAhead = 0;
+    delete m_blocks;
+    m_blocks = 0;
     m_inRAM = 0;
     m_inRAMSize = 0;
 
@@ -245,18 +330,10 @@ Reader::close()
     {
         delete m_in;
         m_in = 0;
-#ifdef GTO_SUPPORT_ZIP
-
-        if (m_gzfile) 
-        {
-            #if ZLIB_VERNUM >= UPDATED_ZLIB_VERNUM
-                gzclose((gzFile_s*)m_gzfile);
-            #else
-                gzclose(m_gzfile);
-            #endif
-            m_gzfile = 0;
-        }
-#endif
+        delete m_gzfile;
+        m_gzfile = 0;
+        delete m_indexedGz;
+        m_indexedGz = 0;
     }
 
     //
@@ -267,8 +344,13 @@ Reader::close()
     m_objects.clear();
     m_components.clear();
     m_properties.clear();
+    m_stringPool->clear();
+    m_objectIndex->clear();
+    m_componentIndex->clear();
+    m_propertyIndex->clear();
     m_strings.clear();
-    m_stringMap.clear();
+    m_stringBuilt.clear();
+    m_numBuilt = 0;
     m_buffer.clear();
 
     m_error        = false;
@@ -281,13 +363,74 @@ Reader::close()
     memset(&m_header, 0, sizeof(m_header));
 }
 
+bool
+Reader::mapFile(const char* filename)
+{
+#ifdef GTO_SUPPORT_MMAP
+    int fd = ::open(filename, O_RDONLY);
+    if (fd == -1) return false;
+
+    struct stat buf;
+
+    if (fstat(fd, &buf) || size_t(buf.st_size) < sizeof(Header))
+    {
+        ::close(fd);
+        return false;
+    }
+
+    size_t size = buf.st_size;
+    void*  p    = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+
+    if (p == MAP_FAILED) return false;
+
+    //
+    //  Only uncompressed binary files can be used in place. Anything
+    //  else (gzipped or text) goes through the usual stream path.
+    //
+
+    uint32 magic = *reinterpret_cast<const uint32*>(p);
+
+    if (magic != Header::Magic && magic != Header::Cigam)
+    {
+        munmap(p, size);
+        return false;
+    }
+
+    madvise(p, size, (m_mode & RandomAccess) ? MADV_RANDOM : MADV_SEQUENTIAL);
+
+    m_mapping         = p;
+    m_mappingSize     = size;
+    m_inRAM           = (const char*)p;
+    m_inRAMSize       = size;
+    m_inRAMCurrentPos = 0;
+    return true;
+#else
+    return false;
+#endif
+}
+
+void
+Reader::unmapFile()
+{
+#ifdef GTO_SUPPORT_MMAP
+    if (m_mapping) munmap(m_mapping, m_mappingSize);
+#endif
+    m_mapping     = 0;
+    m_mappingSize = 0;
+}
+
 void Reader::header(const Header&) {}
 Reader::Request Reader::object(const string&, const string&, unsigned int,
                     const ObjectInfo &) { return Request(true); }
 Reader::Request Reader::component(const string&, const ComponentInfo &) { return Request(true); }
 Reader::Request Reader::property(const string&, const PropertyInfo &) { return Request(true); }
 void* Reader::data(const PropertyInfo&, size_t) { return 0; }
+bool Reader::dataView(const PropertyInfo&, const void*, size_t) { return false; }
 void Reader::dataRead(const PropertyInfo&) {}
+bool Reader::dataChunk(const PropertyInfo&, const void*, size_t, size_t) { return true; }
+void* Reader::transposedData(const ComponentInfo&, size_t) { return 0; }
+void Reader::transposedDataRead(const ComponentInfo&) {}
 void Reader::descriptionComplete() {}
 
 Reader::Request 
@@ -311,33 +454,7 @@ Reader::property(const string& name,
 static void
 swapWords(void *data, size_t size)
 {
-    struct bytes { char c[4]; };
-
-    bytes* ip = reinterpret_cast<bytes*>(data);
-
-    for (size_t i=0; i<size; i++)
-    {
-        bytes temp = ip[i];
-        ip[i].c[0] = temp.c[3];
-        ip[i].c[1] = temp.c[2];
-        ip[i].c[2] = temp.c[1];
-        ip[i].c[3] = temp.c[0];
-    }
-}
-
-static void
-swapShorts(void *data, size_t size)
-{
-    struct bytes { char c[2]; };
-
-    bytes* ip = reinterpret_cast<bytes*>(data);
-
-    for (size_t i=0; i<size; i++)
-    {
-        bytes temp = ip[i];
-        ip[i].c[0] = temp.c[1];
-        ip[i].c[1] = temp.c[0];
-    }
+    swapData(data, size, Int);
 }
 
 void
@@ -380,48 +497,159 @@ Reader::readHeader()
         return;
     }
 
-    header(m_header);
+    //
+    //  The real header of a streamed file is read by readFooter()
+    //
+
+    if (!(m_header.flags & HeaderAtEnd)) header(m_header);
+}
+
+bool
+Reader::readFooter()
+{
+    //
+    //  Find the end of the file. gzseek() can't seek from the end so
+    //  compressed files have to be read through.
+    //
+
+    const uint64 start = tell() - sizeof(Header);
+    uint64       end   = 0;
+
+    if (m_blocks)
+    {
+        end = m_blocks->size();
+    }
+    else if (m_inRAM)
+    {
+        end = m_inRAMSize;
+    }
+    else if (m_in)
+    {
+        m_in->seekg(0, ios::end);
+        end = std::streamoff(m_in->tellg());
+    }
+    else if (m_gzfile)
+    {
+        vector<char> buffer(64 * 1024);
+        while (m_gzfile->read(&buffer.front(), buffer.size()) == buffer.size());
+        end = m_gzfile->tell();
+    }
+    else if (m_indexedGz)
+    {
+        end = m_indexedGz->size();
+    }
+
+    if (end < start + sizeof(Header) + sizeof(Footer))
+    {
+        fail( "streamed file is missing its footer" );
+        return false;
+    }
+
+    Footer footer;
+    seekTo(end - sizeof(Footer));
+    read((char*)&footer, sizeof(Footer));
+    if (m_error) return false;
+
+    if (m_swapped)
+    {
+        swapWords(&footer, sizeof(Footer) / sizeof(uint32));
+        uint32* w = reinterpret_cast<uint32*>(&footer.headerOffset);
+        std::swap(w[0], w[1]);
+    }
+
+    if (footer.magic != Header::Magic || 
+        start + footer.headerOffset > end - sizeof(Footer))
+    {
+        fail( "bad footer in streamed file" );
+        return false;
+    }
+
+    seekTo(start + footer.headerOffset);
+    readMagicNumber();
+    readHeader();
+
+    if (!m_error && (m_header.flags & HeaderAtEnd))
+    {
+        fail( "bad header in streamed file" );
+    }
+
+    return !m_error;
 }
 
 int
 Reader::internString(const std::string& s)
 {
-    StringMap::iterator i = m_stringMap.find(s);
+    uint32 id = m_stringPool->intern(s.data(), s.size());
 
-    if (i == m_stringMap.end())
+    if (id == m_strings.size())
     {
         m_strings.push_back(s);
-        int index = m_strings.size() - 1;
-        m_stringMap[s] = index;
-        return index;
-    }
-    else
-    {
-        return i->second;
+        m_stringBuilt.push_back(true);
+        m_numBuilt++;
     }
+
+    return id;
 }
 
 void
 Reader::readStringTable()
 {
-    for (uint32 i=0; i < m_header.numStrings; i++)
+    //
+    //  Where the source has the data in memory the table is split in
+    //  place, otherwise it is read into a buffer a piece at a time.
+    //  Either way it goes straight into the pool: the std::strings in
+    //  m_strings are only made if someone asks for them.
+    //
+    //  The size of the table isn't known but each of the strings left
+    //  takes at least one byte, so reading no more than that many
+    //  bytes never reads past it.
+    //
+
+    const size_t numStrings = m_header.numStrings;
+    const bool   buffered   = m_readAhead || m_blocks || m_inRAM || m_indexedGz;
+    char         buffer[4096];
+
+    while (m_stringPool->size() < numStrings)
     {
-        string s;
-        char c;
+        const size_t count = numStrings - m_stringPool->size();
+        size_t       available = 0;
 
-        for (get(c); c && notEOF(); get(c))
+        if (const char* p = peek(available))
         {
-            s.push_back(c);
+            seekForward(m_stringPool->append(p, available, count));
+        }
+        else if (!buffered && (m_in || m_gzfile))
+        {
+            const size_t n = std::min(count, sizeof(buffer));
+            read(buffer, n);
+            if (m_error) return;
+            m_stringPool->append(buffer, n, count);
+        }
+        else
+        {
+            fail( "malformed file, truncated string table" );
+            return;
         }
-
-        m_strings.push_back(s);
     }
+
+    m_strings.resize(numStrings);
+    m_stringBuilt.assign(numStrings, false);
+    m_numBuilt = 0;
 }
 
+//
+//  The header records are reserved up front from the counts in the
+//  file. The counts are only trusted so far: past that the vectors
+//  grow as they're read.
+//
+
+static const size_t MaxReserve = 1 << 20;
+
 void
 Reader::readObjects()
 {
     int coffset = 0;
+    m_objects.reserve(std::min(size_t(m_header.numObjects), MaxReserve));
 
     for (uint32 i=0; i < m_header.numObjects; i++)
     {
@@ -441,8 +669,8 @@ Reader::readObjects()
 
         if (m_swapped) swapWords(&o, sizeof(ObjectHeader) / sizeof(int));
 
-        stringFromId(o.name);
-        stringFromId(o.protocolName);
+        validStringId(o.name);
+        validStringId(o.protocolName);
         o.coffset = coffset;
         coffset += o.numComponents;
 
@@ -470,7 +698,19 @@ Reader::readObjects()
 void
 Reader::readComponents()
 {
-    int poffset = 0;
+    int    poffset = 0;
+    size_t total   = 0;
+    
+    for (size_t i = 0; i < m_objects.size(); i++) total += m_objects[i].numComponents;
+    m_components.reserve(std::min(total, MaxReserve));
+
+    //
+    //  The vector may still move while it's being read so the parent
+    //  pointers are set again when it's finished
+    //
+
+    vector<size_t> parents;
+    parents.reserve(m_components.capacity());
 
     for (Objects::iterator i = m_objects.begin();
          i != m_objects.end();
@@ -502,32 +742,39 @@ Reader::readComponents()
             c.parent   = NULL;
             poffset   += c.numProperties;
 
-            for (size_t ioffset = 1; c.parent == 0 && ioffset <= q; ioffset++)
+            size_t parent = size_t(-1);
+
+            for (size_t ioffset = 1; ioffset <= q; ioffset++)
             {
                 const size_t index = m_components.size() - ioffset;
 
                 if (m_components[index].childLevel < c.childLevel)
                 {
                     c.parent = &m_components[index];
+                    parent   = index;
                     break;
                 }
             }
 
-            if (c.parent)
+            if (m_mode & CompactHeader)
             {
-                ostringstream str;
-                str << c.parent->fullName << "." << stringFromId(c.name);
-                c.fullName = str.str();
+                validStringId(c.name);
             }
             else
             {
-                c.fullName = stringFromId(c.name);
+                if (parent != size_t(-1))
+                {
+                    c.fullName = m_components[parent].fullName;
+                    c.fullName += ".";
+                }
+
+                appendString(c.fullName, c.name);
             }
 
             if (o.requested && !(m_mode & RandomAccess))
             {
-                stringFromId(c.name);       // sanity checks
-                stringFromId(c.interpretation);
+                validStringId(c.name);       // sanity checks
+                validStringId(c.interpretation);
                 if (m_error) return;
 
                 Request r = component(stringFromId(c.name), 
@@ -543,13 +790,24 @@ Reader::readComponents()
             }
 
             m_components.push_back(c);
+            parents.push_back(parent);
         }
     }
+
+    for (size_t i = 0; i < m_components.size(); i++)
+    {
+        if (parents[i] != size_t(-1)) m_components[i].parent = &m_components[parents[i]];
+    }
 }
 
 void
 Reader::readProperties()
 {
+    size_t total = 0;
+
+    for (size_t i = 0; i < m_components.size(); i++) total += m_components[i].numProperties;
+    m_properties.reserve(std::min(total, MaxReserve));
+
     for (Components::iterator i = m_components.begin();
          i != m_components.end();
          ++i)
@@ -598,223 +856,1511 @@ Reader::readProperties()
 
             if (m_error) return;
 
+            p.filters = p.type >> GTO_FILTER_SHIFT;
+            p.type   &= GTO_TYPE_MASK;
+            p.readAs  = p.type;
+
+            if (p.filters & ~AllFilters)
+            {
+                fail( "unsupported property filter" );
+                return;
+            }
+
             p.component = &c;
-            p.fullName = c.fullName;
-            p.fullName += ".";
-            p.fullName += stringFromId(p.name);
+
+            if (m_mode & CompactHeader)
+            {
+                validStringId(p.name);
+            }
+            else
+            {
+                p.fullName = c.fullName;
+                p.fullName += ".";
+                appendString(p.fullName, p.name);
+            }
 
             if (c.requested && !(m_mode & RandomAccess))
             {
-                stringFromId(p.name);
-                stringFromId(p.interpretation);
+                validStringId(p.name);
+                validStringId(p.interpretation);
                 if (m_error) return;
 
                 Request r = property(stringFromId(p.name), 
                                      stringFromId(p.interpretation),
                                      p);
 
-                p.requested = r.m_want;
-                p.propertyData = r.m_data;
+                applyRequest(p, r);
             }
             else
             {
                 p.requested = false;
+                p.readAs    = p.type;
             }
 
             m_properties.push_back(p);
         }
+
+        if (c.flags & Gto::Transposed)
+        {
+            //
+            //  Each record holds an element of every property
+            //
+
+            const size_t first = m_properties.size() - c.numProperties;
+
+            for (size_t q = first; q < m_properties.size(); q++)
+            {
+                if (m_properties[q].size != m_properties[first].size ||
+                    m_properties[q].filters)
+                {
+                    fail( "malformed file, bad transposed component" );
+                    return;
+                }
+            }
+        }
     }
 }
 
-bool
-Reader::accessProperty(PropertyInfo& p)
+//
+//  Paths are hashed a name at a time and compared against the string
+//  table a name at a time, so none of them are put together as strings
+//
+
+static uint32
+hashName(const StringPool* pool, uint32 id, uint32 h)
 {
-    Request r = property(stringFromId(p.name), stringFromId(p.interpretation), p);
+    if (id >= pool->size()) return h;
+    return StringPool::hash(pool->data(id), pool->length(id), h);
+}
 
-    p.requested     = r.m_want;
-    p.propertyData  = r.m_data;
+static uint32
+hashDot(uint32 h)
+{
+    return StringPool::hash(".", 1, h);
+}
+
+static bool
+matchName(const StringPool* pool, uint32 id, const char*& p, const char* end)
+{
+    if (id >= pool->size()) return false;
+    size_t n = pool->length(id);
+    if (size_t(end - p) < n || memcmp(p, pool->data(id), n)) return false;
+    p += n;
+    return true;
+}
 
-    if (p.requested)
+static bool
+matchPath(const StringPool* pool, 
+          const Reader::ComponentInfo& c, 
+          const char*& p, 
+          const char* end)
+{
+    if (c.parent)
     {
-        seekTo(p.offset);
-        readProperty(p);
+        if (!matchPath(pool, *c.parent, p, end)) return false;
+    }
+    else if (!matchName(pool, c.object->name, p, end))
+    {
+        return false;
     }
 
-    return true;
+    return p < end && *p++ == '.' && matchName(pool, c.name, p, end);
 }
 
-bool
-Reader::accessComponent(ComponentInfo& c)
+void
+Reader::buildNameIndex()
 {
-    const std::string &nme = stringFromId(c.name);
-    Request            r   = component(nme, c);
-    c.requested            = r.m_want;
-    c.componentData        = r.m_data;
+    m_objectIndex->init(m_objects.size());
+    m_componentIndex->init(m_components.size());
+    m_propertyIndex->init(m_properties.size());
 
-    if (c.requested)
+    vector<uint32> hashes(m_components.size());
+
+    for (size_t i = 0; i < m_objects.size(); i++)
     {
-        for (uint32 j=0; j < c.numProperties; j++)
-        {
-            PropertyInfo& p = m_properties[c.poffset + j];
-            bool success = accessProperty(p);
-            if (!success) return false;
-        }
+        m_objectIndex->insert(hashName(m_stringPool, m_objects[i].name, 
+                                       StringPool::HashSeed), i);
     }
 
-    return true;
+    for (size_t i = 0; i < m_components.size(); i++)
+    {
+        const ComponentInfo& c = m_components[i];
+        uint32 h = c.parent ? hashes[c.parent - &m_components.front()]
+                            : hashName(m_stringPool, c.object->name, 
+                                       StringPool::HashSeed);
+
+        hashes[i] = hashName(m_stringPool, c.name, hashDot(h));
+        m_componentIndex->insert(hashes[i], i);
+    }
+
+    for (size_t i = 0; i < m_properties.size(); i++)
+    {
+        const PropertyInfo& p = m_properties[i];
+        uint32 h = hashes[p.component - &m_components.front()];
+        m_propertyIndex->insert(hashName(m_stringPool, p.name, hashDot(h)), i);
+    }
 }
 
-bool
-Reader::accessObject(ObjectInfo& o)
+Reader::ObjectInfo*
+Reader::findObject(const std::string& name)
 {
-    Request r = object(stringFromId(o.name), 
-                       stringFromId(o.protocolName), 
-                       o.protocolVersion,
-                       o);
-    
-    o.requested  = r.m_want;
-    o.objectData = r.m_data;
+    const char*  end = name.data() + name.size();
+    const uint32 h   = StringPool::hash(name.data(), name.size());
+    size_t       slot;
 
-    if (o.requested)
+    for (int i = m_objectIndex->find(h, slot); i >= 0; i = m_objectIndex->next(h, slot))
+    {
+        const char* p = name.data();
+
+        if (matchName(m_stringPool, m_objects[i].name, p, end) && p == end)
+        {
+            return &m_objects[i];
+        }
+    }
+
+    return 0;
+}
+
+Reader::ComponentInfo*
+Reader::findComponent(const std::string& path)
+{
+    const char*  end = path.data() + path.size();
+    const uint32 h   = StringPool::hash(path.data(), path.size());
+    size_t       slot;
+
+    for (int i = m_componentIndex->find(h, slot); i >= 0; i = m_componentIndex->next(h, slot))
+    {
+        const char* p = path.data();
+
+        if (matchPath(m_stringPool, m_components[i], p, end) && p == end)
+        {
+            return &m_components[i];
+        }
+    }
+
+    return 0;
+}
+
+Reader::PropertyInfo*
+Reader::findProperty(const std::string& path)
+{
+    const char*  end = path.data() + path.size();
+    const uint32 h   = StringPool::hash(path.data(), path.size());
+    size_t       slot;
+
+    for (int i = m_propertyIndex->find(h, slot); i >= 0; i = m_propertyIndex->next(h, slot))
+    {
+        const PropertyInfo& prop = m_properties[i];
+        const char*         p    = path.data();
+
+        if (matchPath(m_stringPool, *prop.component, p, end) &&
+            p < end && *p++ == '.' &&
+            matchName(m_stringPool, prop.name, p, end) && p == end)
+        {
+            return &m_properties[i];
+        }
+    }
+
+    return 0;
+}
+
+bool
+Reader::accessProperty(PropertyInfo& p)
+{
+    Request r = property(stringFromId(p.name), stringFromId(p.interpretation), p);
+
+    applyRequest(p, r);
+
+    if (p.requested && (p.component->flags & Gto::Transposed))
+    {
+        seekTo(recordsOffset(*p.component));
+        return readTransposed(*p.component, vector<PropertyInfo*>(1, &p), p.size);
+    }
+    else if (p.requested)
+    {
+        seekTo(p.offset);
+        readProperty(p);
+    }
+
+    return true;
+}
+
+bool
+Reader::accessPropertyRange(PropertyInfo& p, size_t first, size_t count)
+{
+    if (first > p.size || count > p.size - first) return false;
+
+    Request r = property(stringFromId(p.name), stringFromId(p.interpretation), p);
+
+    applyRequest(p, r);
+
+    if (!p.requested || !count) return true;
+
+    size_t elementBytes = dataSizeInBytes(p.type) * elementSize(p.dims);
+    size_t bytes        = count * elementBytes;
+    uint64 begin        = uint64(first) * elementBytes;
+
+    if (p.component->flags & Gto::Transposed)
+    {
+        seekTo(recordsOffset(*p.component) + uint64(first) * recordSize(*p.component));
+        return readTransposed(*p.component, vector<PropertyInfo*>(1, &p), count);
+    }
+
+    if (p.filters) begin = begin / GTO_FILTER_BLOCK * GTO_FILTER_BLOCK;
+    seekTo(p.offset + begin);
+
+    if (p.readAs != p.type)
+    {
+        size_t outBytes = count * elementSize(p.dims) * dataSizeInBytes(p.readAs);
+
+        if (char* buffer = (char*)data(p, outBytes))
+        {
+            if (readConverted(p, first, count, buffer, false)) dataRead(p);
+        }
+    }
+    else if (m_inRAM && !m_swapped && !p.filters &&
+        m_inRAMCurrentPos + bytes <= m_inRAMSize &&
+        dataView(p, m_inRAM + m_inRAMCurrentPos, bytes))
+    {
+        dataRead(p);
+    }
+    else if (m_chunkBuffer && elementBytes <= m_chunkBufferSize)
+    {
+        if (readSlice(p, first, count, (char*)m_chunkBuffer, 
+                      m_chunkBufferSize, true, false))
+        {
+            dataRead(p);
+        }
+    }
+    else if (char* buffer = (char*)data(p, bytes))
+    {
+        if (readSlice(p, first, count, buffer, bytes, false, false))
+        {
+            dataRead(p);
+        }
+    }
+
+    return !m_error;
+}
+
+//
+//  Requests less than this far apart are read as one run
+//
+
+static const uint64 CoalesceGap = 256 * 1024;
+
+static uint64
+propertyBytes(const Reader::PropertyInfo& p)
+{
+    return uint64(p.size) * elementSize(p.dims) * dataSizeInBytes(p.type);
+}
+
+struct PropertyOffsetLess
+{
+    bool operator() (const Reader::PropertyInfo* a, 
+                     const Reader::PropertyInfo* b) const
+    {
+        return a->offset < b->offset;
+    }
+};
+
+bool
+Reader::accessProperties(const std::vector<PropertyInfo*>& props)
+{
+    vector<PropertyInfo*> plan;
+    bool                  convert    = false;
+    bool                  transposed = false;
+
+    for (size_t i = 0; i < props.size(); i++)
+    {
+        PropertyInfo& p = *props[i];
+        Request r = property(stringFromId(p.name), stringFromId(p.interpretation), p);
+
+        applyRequest(p, r);
+
+        if (p.requested) plan.push_back(&p);
+        if (p.readAs != p.type) convert = true;
+        if (p.requested && (p.component->flags & Gto::Transposed)) transposed = true;
+    }
+
+    std::sort(plan.begin(), plan.end(), PropertyOffsetLess());
+    plan.erase(std::unique(plan.begin(), plan.end()), plan.end());
+
+    //
+    //  Merge the requests into runs of [start, end) pairs
+    //
+
+    vector<uint64> runs;
+
+    for (size_t i = 0; i < plan.size(); i++)
+    {
+        uint64 start = plan[i]->offset;
+        uint64 end   = start + propertyBytes(*plan[i]);
+
+        if (plan[i]->component->flags & Gto::Transposed)
+        {
+            start = recordsOffset(*plan[i]->component);
+            end   = start + uint64(plan[i]->size) * recordSize(*plan[i]->component);
+        }
+
+        if (!runs.empty() && start <= runs.back() + CoalesceGap)
+        {
+            runs.back() = std::max(runs.back(), end);
+        }
+        else
+        {
+            runs.push_back(start);
+            runs.push_back(end);
+        }
+    }
+
+    if ((m_mode & AsyncIO) && !convert && !transposed && readPropertiesAsync(plan)) 
+    {
+        return !m_error;
+    }
+
+    prefetchRuns(runs);
+
+    for (size_t i = 0; i < plan.size(); i++)
+    {
+        //
+        //  Within a run the gaps are skipped going forward
+        //
+
+        const ComponentInfo& comp = *plan[i]->component;
+        const bool           records = (comp.flags & Gto::Transposed) != 0;
+
+        uint64 pos = tell();
+        uint64 offset = records ? recordsOffset(comp) : plan[i]->offset;
+
+        if (offset > pos && offset - pos <= CoalesceGap) 
+        {
+            seekForward(offset - pos);
+        }
+        else if (offset != pos)
+        {
+            seekTo(offset);
+        }
+
+        if (records)
+        {
+            //
+            //  The fields of a transposed component are next to each
+            //  other in the plan and come out of one pass
+            //
+
+            vector<PropertyInfo*> fields;
+            for (; i < plan.size() && plan[i]->component == &comp; i++) fields.push_back(plan[i]);
+            i--;
+
+            if (!readTransposed(comp, fields, fields.front()->size)) return false;
+        }
+        else if (!readProperty(*plan[i])) return false;
+    }
+
+    return !m_error;
+}
+
+#ifdef GTO_SUPPORT_IO_URING
+
+//
+//  One read submitted to the IoRing. Properties larger than a single
+//  read can handle are split into several.
+//
+
+struct AsyncPiece
+{
+    size_t  read;       // index into the batch
+    uint64  offset;     // within the property
+    size_t  bytes;
+};
+
+static const size_t MaxAsyncPiece = 1 << 30;
+
+bool
+Reader::readPropertiesAsync(const vector<PropertyInfo*>& plan)
+{
+    //
+    //  Only plain binary files opened by name can be read this way
+    //
+
+    if (!plainFile() || m_chunkBuffer || plan.empty()) return false;
+
+    IoRing ring;
+    if (!ring.good()) return false;
+
+    int fd = ::open(m_inName.c_str(), O_RDONLY);
+    if (fd == -1) return false;
+
+    //
+    //  Buffers are asked for up front in file order
+    //
+
+    const size_t    n = plan.size();
+    vector<char*>   buffers(n);
+    vector<uint64>  sizes(n);
+    vector<uint64>  queued(n);
+    vector<uint64>  completed(n);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        sizes[i]   = propertyBytes(*plan[i]);
+        buffers[i] = (char*)data(*plan[i], size_t(sizes[i]));
+    }
+
+    vector<AsyncPiece> pieces(ring.capacity());
+    vector<size_t>     freePieces;
+    for (size_t i = pieces.size(); i-- > 0;) freePieces.push_back(i);
+
+    size_t next    = 0;     // next property to queue
+    size_t deliver = 0;     // next property to hand to dataRead()
+    bool   ok      = true;
+
+    while (deliver < n && ok)
+    {
+        //
+        //  Fill the ring
+        //
+
+        while (next < n && !freePieces.empty())
+        {
+            if (!buffers[next] || queued[next] == sizes[next])
+            {
+                next++;
+                continue;
+            }
+
+            size_t      p     = freePieces.back();
+            AsyncPiece& piece = pieces[p];
+            piece.read   = next;
+            piece.offset = queued[next];
+            piece.bytes  = size_t(std::min(sizes[next] - queued[next], 
+                                           uint64(MaxAsyncPiece)));
+
+            if (!ring.read(fd, buffers[next] + piece.offset, piece.bytes,
+                           plan[next]->offset + piece.offset, p))
+            {
+                break;
+            }
+
+            freePieces.pop_back();
+            queued[next] += piece.bytes;
+        }
+
+        //
+        //  Completed properties are decoded and handed over in file
+        //  order
+        //
+
+        while (deliver < n && 
+               (!buffers[deliver] || completed[deliver] == sizes[deliver]))
+        {
+            if (buffers[deliver])
+            {
+                decodeProperty(*plan[deliver], buffers[deliver], 
+                               size_t(sizes[deliver]));
+                dataRead(*plan[deliver]);
+            }
+
+            deliver++;
+        }
+
+        if (deliver == n) break;
+
+        uint64 p;
+        int    result;
+
+        if (freePieces.size() == pieces.size() || !ring.wait(p, result))
+        {
+            ok = false;
+            break;
+        }
+
+        AsyncPiece& piece = pieces[size_t(p)];
+        char*       out   = buffers[piece.read] + piece.offset;
+        size_t      done  = result > 0 ? size_t(result) : 0;
+
+        //
+        //  Short or failed reads are finished off synchronously
+        //
+
+        while (done < piece.bytes)
+        {
+            ssize_t r = pread(fd, out + done, piece.bytes - done, 
+                              off_t(plan[piece.read]->offset + piece.offset + done));
+            if (r <= 0) break;
+            done += r;
+        }
+
+        if (done < piece.bytes) ok = false;
+
+        completed[piece.read] += piece.bytes;
+        freePieces.push_back(size_t(p));
+    }
+
+    //
+    //  On failure wait for the reads still in flight so nothing
+    //  writes into the buffers behind our back, then read the
+    //  properties not yet handed over synchronously. If the ring
+    //  can't even be drained the remaining buffers are abandoned:
+    //  dataRead() is not called for them.
+    //
+
+    bool drained = true;
+
+    while (!ok && freePieces.size() < pieces.size())
+    {
+        uint64 p;
+        int    result;
+
+        if (!ring.wait(p, result))
+        {
+            drained = false;
+            break;
+        }
+
+        freePieces.push_back(size_t(p));
+    }
+
+    if (drained) ok = true;
+
+    for (; ok && deliver < n; deliver++)
+    {
+        if (!buffers[deliver]) continue;
+
+        uint64 done = 0;
+
+        while (done < sizes[deliver])
+        {
+            size_t  bytes = size_t(std::min(sizes[deliver] - done, 
+                                            uint64(MaxAsyncPiece)));
+            ssize_t r     = pread(fd, buffers[deliver] + done, bytes,
+                                  off_t(plan[deliver]->offset + done));
+            if (r <= 0) break;
+            done += r;
+        }
+
+        if (done < sizes[deliver])
+        {
+            ok = false;
+            break;
+        }
+
+        decodeProperty(*plan[deliver], buffers[deliver], 
+                       size_t(sizes[deliver]));
+        dataRead(*plan[deliver]);
+    }
+
+    ::close(fd);
+
+    if (!ok)
+    {
+        std::cerr << "ERROR: Gto::Reader: Failed to read gto file: '"
+                  << m_inName << "'" << std::endl;
+        fail("async read failed");
+    }
+
+    return true;
+}
+
+#else
+
+//
+//  Without io_uring the caller reads the properties itself
+//
+
+bool
+Reader::readPropertiesAsync(const vector<PropertyInfo*>&)
+{
+    return false;
+}
+
+#endif
+
+//
+//  A gzip file with an index next to it (see GzipIndex) is read
+//  through the index so seeks don't inflate everything in front of
+//  their target. A missing or stale index is ignored.
+//
+
+void
+Reader::openGzipIndex()
+{
+    if (!m_gzfile || m_gzfile->direct()) return;
+
+    IndexedGzipFile* file = new IndexedGzipFile;
+
+    if (file->open(m_inName.c_str()) && file->seek(uint64(m_gzfile->tell())))
+    {
+        delete m_gzfile;
+        m_gzfile    = 0;
+        m_indexedGz = file;
+    }
+    else
+    {
+        delete file;
+    }
+}
+
+//
+//  True if the file was opened by name and its data sits in it
+//  uncompressed at the offsets in the header. A second descriptor can
+//  then be used on it.
+//
+
+bool
+Reader::plainFile()
+{
+    if (!m_needsClosing || m_blocks || m_inRAM) return false;
+    return m_gzfile ? m_gzfile->direct() : m_in != 0;
+}
+
+void
+Reader::prefetchRuns(const vector<uint64>& runs)
+{
+    if (runs.empty()) return;
+
+    if (m_blocks)
+    {
+        //
+        //  Decompress the blocks covering the runs ahead of the reads
+        //
+
+        if (m_numThreads == 1) return;
+
+        const uint64   blockSize = m_blocks->header().blockSize;
+        vector<size_t> blocks;
+
+        for (size_t i = 0; i < runs.size(); i += 2)
+        {
+            if (runs[i+1] == runs[i]) continue;
+
+            size_t b0 = size_t(runs[i] / blockSize);
+            size_t b1 = size_t((runs[i+1] - 1) / blockSize);
+
+            if (!blocks.empty() && b0 <= blocks.back()) b0 = blocks.back() + 1;
+            for (size_t b = b0; b <= b1; b++) blocks.push_back(b);
+        }
+
+        if (!blocks.empty()) m_blocks->prefetch(blocks, m_numThreads);
+    }
+#ifdef GTO_SUPPORT_MMAP
+    else if (m_mapping)
+    {
+        const uint64 page = sysconf(_SC_PAGESIZE);
+
+        for (size_t i = 0; i < runs.size(); i += 2)
+        {
+            uint64 start = runs[i] / page * page;
+            uint64 end   = std::min(runs[i+1], uint64(m_mappingSize));
+            if (end <= start) continue;
+
+            madvise((char*)m_mapping + start, size_t(end - start), 
+                    MADV_WILLNEED);
+        }
+    }
+#endif
+#ifdef POSIX_FADV_WILLNEED
+    else if (plainFile())
+    {
+        //
+        //  The hints apply to the file's pages, not the descriptor, so
+        //  a second descriptor can be used to give them
+        //
+
+        int fd = ::open(m_inName.c_str(), O_RDONLY);
+        if (fd == -1) return;
+
+        for (size_t i = 0; i < runs.size(); i += 2)
+        {
+            posix_fadvise(fd, off_t(runs[i]), off_t(runs[i+1] - runs[i]),
+                          POSIX_FADV_WILLNEED);
+        }
+
+        ::close(fd);
+    }
+#endif
+}
+
+bool
+Reader::accessComponent(ComponentInfo& c)
+{
+    const std::string &nme = stringFromId(c.name);
+    Request            r   = component(nme, c);
+    c.requested            = r.m_want;
+    c.componentData        = r.m_data;
+
+    if (c.requested && (c.flags & Gto::Transposed) && c.numProperties)
+    {
+        vector<PropertyInfo*> wanted;
+
+        for (uint32 j=0; j < c.numProperties; j++)
+        {
+            PropertyInfo& p = m_properties[c.poffset + j];
+            Request r = property(stringFromId(p.name), stringFromId(p.interpretation), p);
+            applyRequest(p, r);
+            if (p.requested) wanted.push_back(&p);
+        }
+
+        if (wanted.empty()) return true;
+        seekTo(recordsOffset(c));
+        return readTransposedComponent(c, wanted);
+    }
+    else if (c.requested)
+    {
+        for (uint32 j=0; j < c.numProperties; j++)
+        {
+            PropertyInfo& p = m_properties[c.poffset + j];
+            bool success = accessProperty(p);
+            if (!success) return false;
+        }
+    }
+
+    return true;
+}
+
+bool
+Reader::accessObject(ObjectInfo& o)
+{
+    Request r = object(stringFromId(o.name), 
+                       stringFromId(o.protocolName), 
+                       o.protocolVersion,
+                       o);
+    
+    o.requested  = r.m_want;
+    o.objectData = r.m_data;
+
+    if (o.requested)
     {
         for (uint32 q=0; q < o.numComponents; q++)
         {
-            assert( (o.coffset+q) < m_components.size() );
+            assert( (o.coffset+q) < m_components.size() );
+
+            ComponentInfo& c = m_components[o.coffset + q];
+            bool success = accessComponent(c);
+            if (!success) return false;
+        }
+    }
+
+    return true;
+}
+
+bool
+Reader::readTextGTO()
+{
+    m_header.magic = Header::MagicText;
+
+    if (!::GTOParse(this))
+    {
+        fail("failed to parse text GTO");
+        return false;
+    }
+    
+    header(m_header);
+    buildNameIndex();
+    descriptionComplete();
+    return true;
+}
+
+bool
+Reader::readBlockGTO()
+{
+    //
+    //  From here on all input goes through the block reader which
+    //  presents the uncompressed binary GTO file inside.
+    //
+
+    m_blocks = new BlockReader;
+
+    bool ok = m_inRAM ? m_blocks->open(m_inRAM, m_inRAMSize) 
+                      : m_blocks->open(*m_in);
+
+    m_inRAM           = 0;
+    m_inRAMSize       = 0;
+    m_inRAMCurrentPos = 0;
+
+    if (!ok)
+    {
+        fail( m_blocks->why() );
+        return false;
+    }
+
+    readMagicNumber();
+
+    if (m_header.magic != Header::Magic &&
+        m_header.magic != Header::Cigam)
+    {
+        fail( "block compressed file does not contain a binary GTO file" );
+        return false;
+    }
+
+    return readBinaryGTO();
+}
+
+bool
+Reader::readBinaryGTO()
+{
+    readHeader();           if (m_error) return false; 
+
+    uint64 dataOffset = 0;
+
+    if (m_header.flags & HeaderAtEnd)
+    {
+        dataOffset = tell();
+        if (!readFooter()) return false;
+    }
+    else
+    {
+        startReadAhead();
+    }
+
+    readStringTable();      if (m_error) return false;
+    readObjects();          if (m_error) return false;
+    readComponents();       if (m_error) return false;
+    readProperties();       if (m_error) return false;
+    buildNameIndex();
+    descriptionComplete();
+
+    if (m_mode & HeaderOnly)
+    {
+        return true;
+    }
+
+    if (dataOffset) 
+    {
+        seekTo(dataOffset);
+        startReadAhead();
+    }
+
+    if (m_blocks && m_numThreads != 1 && !(m_mode & RandomAccess))
+    {
+        prefetchBlocks();
+    }
+
+    Properties::iterator p = m_properties.begin();
+
+    for (Components::iterator i = m_components.begin();
+         i != m_components.end();
+         ++i)
+    {
+        ComponentInfo &comp = *i;
+            
+        if (comp.flags & Gto::Transposed)
+        {
+            //
+            //  The property offsets point at their fields in the first
+            //  record
+            //
 
-            ComponentInfo& c = m_components[o.coffset + q];
-            bool success = accessComponent(c);
-            if (!success) return false;
+            const uint64          start = tell();
+            vector<PropertyInfo*> wanted;
+
+            for (Properties::iterator e = p + comp.numProperties; p != e; ++p)
+            {
+                p->offset = start + fieldOffset(*p);
+                if (p->requested) wanted.push_back(&*p);
+            }
+
+            if (!readTransposedComponent(comp, wanted)) return false;
+        }
+        else
+        {
+            for (Properties::iterator e = p + comp.numProperties; p != e; ++p)
+            {
+                if (!readProperty(*p))
+                {
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+void
+Reader::startReadAhead()
+{
+    //
+    //  Everything from the current position on goes through the ring
+    //
+
+    if (!(m_mode & ReadAhead) || (m_mode & (RandomAccess | HeaderOnly)) ||
+        m_readAhead || m_blocks || m_inRAM)
+    {
+        return;
+    }
+
+    if (m_in)
+    {
+        m_readAhead = new ReadAheadStream(m_in, m_readAheadSize, 
+                                          m_readAheadBuffers);
+    }
+    else if (m_gzfile)
+    {
+        m_readAhead = new ReadAheadStream(m_gzfile, m_readAheadSize, 
+                                          m_readAheadBuffers);
+    }
+}
+
+void
+Reader::prefetchBlocks()
+{
+    //
+    //  Find the blocks covering the requested properties. The data
+    //  follows the header in declaration order.
+    //
+
+    const uint64   blockSize = m_blocks->header().blockSize;
+    uint64         offset    = tell();
+    vector<size_t> blocks;
+
+    for (size_t i = 0; i < m_properties.size(); i++)
+    {
+        const PropertyInfo& prop = m_properties[i];
+        uint64 bytes = uint64(prop.size) * elementSize(prop.dims) * 
+                       dataSizeInBytes(prop.type);
+
+        bool wanted = prop.requested;
+
+        if (prop.component->flags & Gto::Transposed)
+        {
+            //
+            //  All of the records are read if any field is wanted
+            //
+
+            const PropertyInfo* first = &m_properties[prop.component->poffset];
+
+            for (size_t q = 0; q < prop.component->numProperties; q++)
+            {
+                wanted = wanted || first[q].requested;
+            }
+        }
+
+        if (wanted && bytes)
+        {
+            size_t b0 = size_t(offset / blockSize);
+            size_t b1 = size_t((offset + bytes - 1) / blockSize);
+
+            if (!blocks.empty() && b0 <= blocks.back()) b0 = blocks.back() + 1;
+            for (size_t b = b0; b <= b1; b++) blocks.push_back(b);
+        }
+
+        offset += bytes;
+    }
+
+    if (!blocks.empty()) m_blocks->prefetch(blocks, m_numThreads);
+}
+
+bool
+Reader::readProperty(PropertyInfo& prop)
+{
+    size_t num   = prop.size * elementSize(prop.dims);
+    size_t bytes = dataSizeInBytes(prop.type) * num;
+    char* buffer = 0;
+
+    //
+    //  Cache the offset pointer
+    //
+
+    prop.offset = tell();
+    bool readok = false;
+    size_t elementBytes = dataSizeInBytes(prop.type) * elementSize(prop.dims);
+
+    if (prop.requested && prop.readAs != prop.type)
+    {
+        //
+        //  Converted on the way into the caller's buffer
+        //
+
+        if ((buffer = (char*)data(prop, num * dataSizeInBytes(prop.readAs))))
+        {
+            if (!readConverted(prop, 0, prop.size, buffer, true)) return false;
+            dataRead(prop);
+        }
+        else
+        {
+            seekForward(bytes);
+        }
+
+        return !m_error;
+    }
+    else if (prop.requested)
+    {
+        if (m_inRAM && !m_swapped && !prop.filters && bytes &&
+            m_inRAMCurrentPos + bytes <= m_inRAMSize &&
+            dataView(prop, m_inRAM + m_inRAMCurrentPos, bytes))
+        {
+            //
+            //  The caller took the data in place
+            //
+
+            seekForward(bytes);
+            readok = true;
+        }
+        else if (m_chunkBuffer && elementBytes && 
+                 elementBytes <= m_chunkBufferSize)
+        {
+            if (readSlice(prop, 0, prop.size, (char*)m_chunkBuffer, 
+                          m_chunkBufferSize, true, true))
+            {
+                dataRead(prop);
+            }
+
+            return !m_error;
+        }
+        else if ((buffer = (char*)data(prop, bytes)))
+        {
+            if (prop.filters) read(buffer, bytes);
+            else readData(buffer, bytes, prop.type);
+            if (!m_error) readok = true;
+        }
+        else
+        {
+            seekForward(bytes);
         }
     }
+    else
+    {
+        seekForward(bytes);
+    }
+
+    if (m_error) return false;
+
+    if (readok)
+    {
+        if (buffer && prop.filters) decodeProperty(prop, buffer, bytes);
+        dataRead(prop);
+    }
+
+
+    return true;
+}
+
+void
+Reader::applyRequest(PropertyInfo& prop, const Request& r)
+{
+    prop.requested    = r.m_want;
+    prop.propertyData = r.m_data;
+    prop.readAs       = prop.type;
+
+    if (r.m_type != ErrorType && canConvert(prop.type, r.m_type))
+    {
+        prop.readAs = r.m_type;
+    }
+}
+
+bool
+Reader::readConverted(PropertyInfo& prop, 
+                      size_t first, 
+                      size_t count, 
+                      char* out,
+                      bool toEnd)
+{
+    //
+    //  Converts elements [first, first + count) of the property into
+    //  out. The input is positioned as for readSlice(). Unfiltered data
+    //  is converted straight from the source when it's in memory and
+    //  byte swapped as it's converted. Otherwise it goes through
+    //  m_filterBlock a piece at a time.
+    //
+
+    const size_t wordSize  = dataSizeInBytes(prop.type);
+    const size_t outSize   = dataSizeInBytes(prop.readAs);
+    const size_t values    = elementSize(prop.dims);
+    const uint64 propBytes = uint64(prop.size) * values * wordSize;
+    const uint64 begin     = uint64(first) * values * wordSize;
+    const uint64 end       = begin + uint64(count) * values * wordSize;
+    uint64       pos       = begin;
+
+    m_filterBlock.resize(GTO_FILTER_BLOCK);
+    char* block = (char*)&m_filterBlock.front();
+
+    if (!prop.filters)
+    {
+        while (pos < end)
+        {
+            size_t      available = 0;
+            const char* p         = peek(available);
+            size_t      num       = size_t(std::min(uint64(available), end - pos)) / wordSize;
+
+            if (num)
+            {
+                convertData(p, prop.type, out, prop.readAs, num, m_swapped);
+                seekForward(num * wordSize);
+            }
+            else
+            {
+                num = size_t(std::min(end - pos, uint64(GTO_FILTER_BLOCK))) / wordSize;
+                read(block, num * wordSize);
+                if (m_error) return false;
+                convertData(block, prop.type, out, prop.readAs, num, m_swapped);
+            }
+
+            pos += num * wordSize;
+            out += num * outSize;
+        }
+    }
+    else
+    {
+        pos = begin / GTO_FILTER_BLOCK * GTO_FILTER_BLOCK;
+
+        while (pos < end)
+        {
+            size_t n = size_t(std::min(propBytes - pos, uint64(GTO_FILTER_BLOCK)));
+            read(block, n);
+            if (m_error) return false;
+
+            if (prop.filters & ShuffleFilter) unshuffleBytes(block, n, wordSize);
+            if (m_swapped) swapData(block, n / wordSize, prop.type);
+            if (prop.filters & DeltaFilter) deltaDecode(block, n, wordSize);
+
+            size_t offset = size_t(std::max(begin, pos) - pos);
+            size_t last   = size_t(std::min(end, pos + n) - pos);
+            size_t num    = (last - offset) / wordSize;
+
+            convertData(block + offset, prop.type, out, prop.readAs, num);
+            out += num * outSize;
+            pos += n;
+        }
+    }
+
+    if (toEnd && pos < propBytes) seekForward(propBytes - pos);
+    return !m_error;
+}
+
+void
+Reader::readData(char* out, size_t bytes, uint32 type)
+{
+    //
+    //  Reads bytes of data of the given type. If the file is byte
+    //  swapped, data which is already in memory (in RAM, mapped, the
+    //  read ahead ring or the block cache) is swapped as it's copied
+    //  out rather than copied and then swapped in place.
+    //
+
+    const size_t wordSize = dataSizeInBytes(type);
+
+    if (!m_swapped || wordSize < 2)
+    {
+        read(out, bytes);
+        return;
+    }
+
+    while (bytes && !m_error)
+    {
+        size_t      available = 0;
+        const char* p         = peek(available);
+        size_t      n         = std::min(available, bytes) / wordSize * wordSize;
+
+        if (n)
+        {
+            swapCopy(p, out, n / wordSize, type);
+            seekForward(n);
+        }
+        else
+        {
+            //
+            //  Not buffered, or a value straddles the end of a buffer
+            //
+
+            n = available ? wordSize : bytes;
+            read(out, n);
+            if (!m_error) swapData(out, n / wordSize, type);
+        }
+
+        out   += n;
+        bytes -= n;
+    }
+}
+
+size_t
+Reader::recordSize(const ComponentInfo& comp) const
+{
+    size_t bytes = 0;
+
+    for (size_t i = 0; i < comp.numProperties; i++)
+    {
+        const PropertyInfo& p = m_properties[comp.poffset + i];
+        bytes += elementSize(p.dims) * dataSizeInBytes(p.type);
+    }
+
+    return bytes;
+}
+
+size_t
+Reader::fieldOffset(const PropertyInfo& prop) const
+{
+    size_t bytes = 0;
+
+    for (const PropertyInfo* p = &m_properties[prop.component->poffset]; p != &prop; p++)
+    {
+        bytes += elementSize(p->dims) * dataSizeInBytes(p->type);
+    }
+
+    return bytes;
+}
+
+uint64
+Reader::recordsOffset(const ComponentInfo& comp) const
+{
+    return m_properties[comp.poffset].offset;
+}
+
+bool
+Reader::readTransposedComponent(const ComponentInfo& comp, 
+                                const vector<PropertyInfo*>& wanted)
+{
+    //
+    //  Reads all of a transposed component's records from the current
+    //  position, either as they are or transposed
+    //
+
+    const size_t count = comp.numProperties ? m_properties[comp.poffset].size : 0;
+    const uint64 bytes = uint64(count) * recordSize(comp);
+
+    if (wanted.empty())
+    {
+        seekForward(bytes);
+        return !m_error;
+    }
+
+    if (char* records = (char*)transposedData(comp, size_t(bytes)))
+    {
+        read(records, size_t(bytes));
+        if (m_error) return false;
+        if (m_swapped) swapRecords(comp, records, count);
+        transposedDataRead(comp);
+        return true;
+    }
+
+    return readTransposed(comp, wanted, count);
+}
+
+bool
+Reader::readTransposed(const ComponentInfo& comp, 
+                       const vector<PropertyInfo*>& props,
+                       size_t count)
+{
+    //
+    //  Reads count records from the current position and hands each
+    //  property in props its fields. The records are read a block at
+    //  a time (straight from memory when they're there) and the fields
+    //  are copied out, byte swapped and converted while the block is
+    //  in cache.
+    //
+
+    const size_t recordBytes = recordSize(comp);
+    const size_t perBlock    = std::max(size_t(1), GTO_FILTER_BLOCK / std::max(recordBytes, size_t(1)));
+    vector<char*>  out(props.size());
+    vector<size_t> offsets(props.size());
+    vector<char>   temp;
+
+    for (size_t i = 0; i < props.size(); i++)
+    {
+        PropertyInfo& p      = *props[i];
+        size_t        values = count * elementSize(p.dims);
+
+        offsets[i] = fieldOffset(p);
+        out[i]     = (char*)data(p, values * dataSizeInBytes(p.readAs));
+
+        if (p.readAs != p.type)
+        {
+            size_t bytes = perBlock * elementSize(p.dims) * dataSizeInBytes(p.type);
+            if (temp.size() < bytes) temp.resize(bytes);
+        }
+    }
+
+    m_filterBlock.resize(std::max(size_t(GTO_FILTER_BLOCK), recordBytes));
+
+    for (size_t r = 0; r < count && recordBytes; r += perBlock)
+    {
+        const size_t n         = std::min(count - r, perBlock);
+        const size_t bytes     = n * recordBytes;
+        size_t       available = 0;
+        const char*  block     = peek(available);
+
+        if (available < bytes)
+        {
+            read((char*)&m_filterBlock.front(), bytes);
+            if (m_error) return false;
+            block = (const char*)&m_filterBlock.front();
+        }
+
+        for (size_t i = 0; i < props.size(); i++)
+        {
+            if (!out[i]) continue;
 
-    return true;
-}
+            const PropertyInfo& p          = *props[i];
+            const size_t        values     = elementSize(p.dims);
+            const size_t        fieldBytes = values * dataSizeInBytes(p.type);
 
-bool
-Reader::readTextGTO()
-{
-    m_header.magic = Header::MagicText;
+            if (p.readAs != p.type)
+            {
+                char* o = out[i] + r * values * dataSizeInBytes(p.readAs);
+                unpackField(block, recordBytes, offsets[i], &temp.front(), fieldBytes, n);
+                convertData(&temp.front(), p.type, o, p.readAs, n * values, m_swapped);
+            }
+            else
+            {
+                char* o = out[i] + r * fieldBytes;
+                unpackField(block, recordBytes, offsets[i], o, fieldBytes, n);
+                if (m_swapped) swapData(o, n * values, p.type);
+            }
+        }
 
-    if (!::GTOParse(this))
+        if (available >= bytes) seekForward(bytes);
+    }
+
+    for (size_t i = 0; i < props.size() && !m_error; i++)
     {
-        fail("failed to parse text GTO");
-        return false;
+        if (out[i]) dataRead(*props[i]);
     }
-    
-    header(m_header);
-    descriptionComplete();
-    return true;
+
+    return !m_error;
 }
 
-bool
-Reader::readBinaryGTO()
+void
+Reader::swapRecords(const ComponentInfo& comp, char* records, size_t count)
 {
-    readHeader();           if (m_error) return false; 
-    readStringTable();      if (m_error) return false;
-    readObjects();          if (m_error) return false;
-    readComponents();       if (m_error) return false;
-    readProperties();       if (m_error) return false;
-    descriptionComplete();
+    const size_t        recordBytes = recordSize(comp);
+    const PropertyInfo* props       = &m_properties[comp.poffset];
 
-    if (m_mode & HeaderOnly)
+    for (size_t i = 0, offset = 0; i < comp.numProperties; i++)
     {
-        return true;
-    }
-
-    Properties::iterator p = m_properties.begin();
+        const size_t values = elementSize(props[i].dims);
+        const size_t bytes  = values * dataSizeInBytes(props[i].type);
 
-    for (Components::iterator i = m_components.begin();
-         i != m_components.end();
-         ++i)
-    {
-        ComponentInfo &comp = *i;
-            
-        if (comp.flags & Gto::Transposed)
-        {
-            cerr << "ERROR: Transposed data for '"
-                 << stringFromId( comp.object->name ) << "."
-                 << stringFromId( comp.name ) 
-                 << "' is currently unsupported." << endl;
-            abort();
-        }
-        else
+        if (bytes && dataSizeInBytes(props[i].type) > 1)
         {
-            for (Properties::iterator e = p + comp.numProperties; p != e; ++p)
+            for (size_t r = 0; r < count; r++)
             {
-                if (!readProperty(*p))
-                {
-                    return false;
-                }
+                swapData(records + r * recordBytes + offset, values, props[i].type);
             }
         }
+
+        offset += bytes;
     }
+}
 
-    return true;
+void
+Reader::decodeProperty(PropertyInfo& prop, char* buffer, size_t bytes)
+{
+    size_t wordSize = dataSizeInBytes(prop.type);
+
+    if (prop.filters & ShuffleFilter) unshuffleBytes(buffer, bytes, wordSize);
+    if (m_swapped) swapData(buffer, bytes / wordSize, prop.type);
+    if (prop.filters & DeltaFilter) deltaDecode(buffer, bytes, wordSize);
 }
 
 bool
-Reader::readProperty(PropertyInfo& prop)
+Reader::readSlice(PropertyInfo& prop, 
+                  size_t first, 
+                  size_t count, 
+                  char* out,
+                  size_t outBytes,
+                  bool chunked,
+                  bool toEnd)
 {
-    size_t num   = prop.size * elementSize(prop.dims);
-    size_t bytes = dataSizeInBytes(prop.type) * num;
-    char* buffer = 0;
-
     //
-    //  Cache the offset pointer
+    //  Reads elements [first, first + count) of the property into out
+    //  -- which holds outBytes -- calling dataChunk() each time it
+    //  fills up if chunked. The input must be positioned at the first
+    //  element, or for filtered data at the start of its filter
+    //  block. If toEnd the input is left at the end of the property.
     //
 
-    prop.offset = tell();
-    bool readok = false;
+    size_t wordSize     = dataSizeInBytes(prop.type);
+    size_t elementBytes = wordSize * elementSize(prop.dims);
+    size_t chunkBytes   = outBytes / elementBytes * elementBytes;
+    uint64 propBytes    = uint64(prop.size) * elementBytes;
+    uint64 begin        = uint64(first) * elementBytes;
+    uint64 end          = begin + uint64(count) * elementBytes;
+    uint64 pos          = begin;
+    size_t element      = first;
+    bool   wanted       = true;
 
-    if (prop.requested)
+    if (!prop.filters)
     {
-        if ((buffer = (char*)data(prop, bytes)))
-        {
-            read(buffer, bytes);
-            if (!m_error) readok = true;
-        }
-        else
+        while (pos < end && wanted)
         {
-            seekForward(bytes);
+            size_t n = size_t(std::min(end - pos, uint64(chunkBytes)));
+            readData(out, n, prop.type);
+            if (m_error) return false;
+
+            pos += n;
+            if (chunked) wanted = dataChunk(prop, out, element, n / elementBytes);
+            element += n / elementBytes;
         }
     }
     else
     {
-        seekForward(bytes);
-    }
+        //
+        //  Filters have to be undone a filter block at a time, so the
+        //  blocks are decoded on the side and copied out
+        //
 
-    if (m_error) return false;
+        m_filterBlock.resize(GTO_FILTER_BLOCK);
+        char*  block = (char*)&m_filterBlock.front();
+        size_t fill  = 0;
+        pos = begin / GTO_FILTER_BLOCK * GTO_FILTER_BLOCK;
 
-    if (readok)
-    {
-        if (m_swapped)
+        while (pos < end && wanted)
         {
-            switch (prop.type)
+            size_t n = size_t(std::min(propBytes - pos, uint64(GTO_FILTER_BLOCK)));
+            read(block, n);
+            if (m_error) return false;
+
+            if (prop.filters & ShuffleFilter) unshuffleBytes(block, n, wordSize);
+            if (m_swapped) swapData(block, n / wordSize, prop.type);
+            if (prop.filters & DeltaFilter) deltaDecode(block, n, wordSize);
+
+            size_t offset = size_t(std::max(begin, pos) - pos);
+            size_t last   = size_t(std::min(end, pos + n) - pos);
+            pos += n;
+
+            while (offset < last && wanted)
             {
-              case Gto::Int: 
-              case Gto::String:
-              case Gto::Float: 
-                  swapWords(buffer, num);
-                  break;
-                          
-              case Gto::Short:
-              case Gto::Half: 
-                  swapShorts(buffer, num);
-                  break;
-                          
-              case Gto::Double: 
-                  swapWords(buffer, num * 2);
-                  break;
-                          
-              case Gto::Byte:
-              case Gto::Boolean: 
-                  break;
+                size_t c = std::min(last - offset, chunkBytes - fill);
+                memcpy(out + fill, block + offset, c);
+                fill   += c;
+                offset += c;
+
+                if (fill == chunkBytes || (offset == last && pos >= end))
+                {
+                    if (chunked) 
+                    {
+                        wanted = dataChunk(prop, out, element, fill / elementBytes);
+                    }
+
+                    element += fill / elementBytes;
+                    fill     = 0;
+                }
             }
         }
-
-        dataRead(prop);
     }
 
+    if (toEnd && pos < propBytes) seekForward(propBytes - pos);
+    return !m_error && wanted;
+}
+
+bool
+Reader::deliverChunks(PropertyInfo& prop, const char* data, size_t bytes)
+{
+    size_t elementBytes = dataSizeInBytes(prop.type) * elementSize(prop.dims);
+    size_t chunkBytes   = m_chunkBufferSize / elementBytes * elementBytes;
+    char*  chunk        = (char*)m_chunkBuffer;
+
+    for (size_t offset = 0; offset < bytes; offset += chunkBytes)
+    {
+        size_t n = std::min(bytes - offset, chunkBytes);
+        memcpy(chunk, data + offset, n);
+        
+        if (!dataChunk(prop, chunk, offset / elementBytes, n / elementBytes))
+        {
+            return false;
+        }
+    }
 
     return true;
 }
@@ -822,7 +2368,15 @@ Reader::readProperty(PropertyInfo& prop)
 bool
 Reader::notEOF()
 {
-    if (m_inRAM)
+    if (m_readAhead)
+    {
+        return m_readAhead->good();
+    }
+    else if (m_blocks)
+    {
+        return m_blocks->good();
+    }
+    else if (m_inRAM)
     {
         return (m_inRAMCurrentPos < m_inRAMSize);
     }
@@ -830,12 +2384,10 @@ Reader::notEOF()
     {
         return (!m_in->fail());
     }
-#ifdef GTO_SUPPORT_ZIP
-    else if (m_gzfile)
+    else if (m_gzfile || m_indexedGz)
     {
         return m_gzrval != -1;
     }
-#endif
 
     return false;
 }
@@ -843,7 +2395,27 @@ Reader::notEOF()
 void
 Reader::read(char *buffer, size_t size)
 {
-    if (m_inRAM)
+    if (m_readAhead)
+    {
+        if (m_readAhead->read(buffer, size) != size)
+        {
+            std::cerr << "ERROR: Gto::Reader: Failed to read gto file: '"
+                      << m_inName << "'" << std::endl;
+            memset( buffer, 0, size );
+            fail( "read ahead fail" );
+        }
+    }
+    else if (m_blocks)
+    {
+        if (m_blocks->read(buffer, size) != size)
+        {
+            std::cerr << "ERROR: Gto::Reader: Failed to read gto file: '"
+                      << m_inName << "': " << m_blocks->why() << std::endl;
+            memset( buffer, 0, size );
+            fail( m_blocks->why() );
+        }
+    }
+    else if (m_inRAM)
     {
         bool past_eof = false;
 
@@ -853,11 +2425,8 @@ Reader::read(char *buffer, size_t size)
             past_eof = true;
         }
 
-        for (size_t i=0; i<size; i++)
-        {
-            buffer[i] = m_inRAM[m_inRAMCurrentPos];
-            m_inRAMCurrentPos++;
-        }
+        memcpy(buffer, m_inRAM + m_inRAMCurrentPos, size);
+        m_inRAMCurrentPos += size;
 
         if (past_eof)
         {
@@ -878,45 +2447,40 @@ Reader::read(char *buffer, size_t size)
         }
 #endif
     }
-
-#ifdef GTO_SUPPORT_ZIP
     else if (m_gzfile)
     {
-        char *buffer_pos = buffer;
-        size_t remaining = size;
-        //while (true)
-        while (remaining != 0)
-        {
-            #if ZLIB_VERNUM >= UPDATED_ZLIB_VERNUM
-                int retval = gzread((gzFile_s*)m_gzfile, buffer_pos, remaining);
-            #else
-                int retval = gzread(m_gzfile, buffer_pos, remaining);
-            #endif
-            if (retval <= 0)
-            {
-                int zError = 0;
-                std::cerr << "ERROR: Gto::Reader: Failed to read gto file: ";
-                #if ZLIB_VERNUM >= UPDATED_ZLIB_VERNUM
-                    std::cerr << gzerror( (gzFile_s*)m_gzfile, &zError );
-                #else
-                    std::cerr << gzerror( m_gzfile, &zError );
-                #endif
-                std::cerr << std::endl;
-                memset( buffer, 0, size );
-                fail( "gzread fail" );
-                break;
-            }
-            remaining  -= retval;
-            buffer_pos += retval;
+        if (m_gzfile->read(buffer, size) != size)
+        {
+            std::cerr << "ERROR: Gto::Reader: Failed to read gto file: ";
+            std::cerr << m_gzfile->error() << std::endl;
+            memset( buffer, 0, size );
+            fail( "gzread fail" );
+        }
+    }
+    else if (m_indexedGz)
+    {
+        if (m_indexedGz->read(buffer, size) != size)
+        {
+            std::cerr << "ERROR: Gto::Reader: Failed to read gto file: ";
+            std::cerr << m_indexedGz->error() << std::endl;
+            memset( buffer, 0, size );
+            fail( "indexed gzip read fail" );
         }
     }
-#endif
 }
 
 void
 Reader::get(char &c)
 {
-    if (m_inRAM)
+    if (m_readAhead)
+    {
+        m_readAhead->get(c);
+    }
+    else if (m_blocks)
+    {
+        m_blocks->get(c);
+    }
+    else if (m_inRAM)
     {
         if (m_inRAMSize > m_inRAMCurrentPos)
         {
@@ -932,17 +2496,49 @@ Reader::get(char &c)
     {
         m_in->get(c);
     }
-#ifdef GTO_SUPPORT_ZIP
     else if (m_gzfile)
     {
-        #if ZLIB_VERNUM >= UPDATED_ZLIB_VERNUM
-            m_gzrval = gzgetc((gzFile_s*)m_gzfile);
-        #else
-            m_gzrval = gzgetc(m_gzfile);
-        #endif
+        m_gzrval = m_gzfile->get();
         c = char(m_gzrval);
     }
-#endif
+    else if (m_indexedGz)
+    {
+        m_gzrval = m_indexedGz->get();
+        c = char(m_gzrval);
+    }
+}
+
+//
+//  Returns the data at the current position if the source already has
+//  it in memory (available is how much). Streams return 0 and have to
+//  be read().
+//
+
+const char*
+Reader::peek(size_t& available)
+{
+    available = 0;
+
+    if (m_readAhead)
+    {
+        return m_readAhead->peek(available);
+    }
+    else if (m_blocks)
+    {
+        return m_blocks->peek(available);
+    }
+    else if (m_inRAM)
+    {
+        if (m_inRAMCurrentPos >= m_inRAMSize) return 0;
+        available = m_inRAMSize - m_inRAMCurrentPos;
+        return m_inRAM + m_inRAMCurrentPos;
+    }
+    else if (m_indexedGz)
+    {
+        return m_indexedGz->peek(available);
+    }
+
+    return 0;
 }
 
 void Reader::fail( std::string why )
@@ -951,25 +2547,104 @@ void Reader::fail( std::string why )
     m_why = why;
 }
 
+bool Reader::validStringId(unsigned int i)
+{
+    if (i < m_stringPool->size()) return true;
+
+    std::cerr << "WARNING: Gto::Reader: Malformed gto file: ";
+    std::cerr << "invalid string index" << std::endl;
+    fail( "malformed file, invalid string index" );
+    return false;
+}
+
+void Reader::appendString(std::string& s, unsigned int i)
+{
+    if (validStringId(i))
+    {
+        s.append(m_stringPool->data(i), m_stringPool->length(i));
+    }
+}
+
 const std::string& Reader::stringFromId(unsigned int i)
 {
     static std::string empty( "" );
-    if (i >= m_strings.size())
+    if (!validStringId(i)) return empty;
+
+    if (!m_stringBuilt[i])
     {
-        std::cerr << "WARNING: Gto::Reader: Malformed gto file: ";
-        std::cerr << "invalid string index" << std::endl;
-        fail( "malformed file, invalid string index" );
-        return empty;
+        m_strings[i].assign(m_stringPool->data(i), m_stringPool->length(i));
+        m_stringBuilt[i] = true;
+        m_numBuilt++;
     }
 
     return m_strings[i];
 }
 
+Reader::StringRef Reader::stringRefFromId(unsigned int i)
+{
+    StringRef r;
+    r.data = "";
+    r.size = 0;
+
+    if (validStringId(i))
+    {
+        r.data = m_stringPool->data(i);
+        r.size = m_stringPool->length(i);
+    }
+
+    return r;
+}
+
+const Reader::StringTable& Reader::stringTable()
+{
+    if (m_numBuilt != m_strings.size())
+    {
+        for (size_t i = 0; i < m_strings.size(); i++) stringFromId(i);
+    }
+
+    return m_strings;
+}
+
+std::string Reader::fullName(const ComponentInfo& c) const
+{
+    vector<uint32> names;
+    for (const ComponentInfo* p = &c; p; p = p->parent) names.push_back(p->name);
+
+    std::string name;
+
+    for (size_t i = names.size(); i--;)
+    {
+        if (names[i] < m_stringPool->size())
+        {
+            name.append(m_stringPool->data(names[i]), m_stringPool->length(names[i]));
+        }
+
+        if (i) name += ".";
+    }
+
+    return name;
+}
+
+std::string Reader::fullName(const PropertyInfo& p) const
+{
+    std::string name = fullName(*p.component);
+    name += ".";
+
+    if (p.name < m_stringPool->size())
+    {
+        name.append(m_stringPool->data(p.name), m_stringPool->length(p.name));
+    }
+
+    return name;
+}
+
 unsigned int Reader::idFromString(const std::string& s)
 {
-    if (m_stringMap.count(s) > 1)
+    int id = m_stringPool->find(s.data(), s.size());
+
+    if (id >= 0)
     {
-        return m_stringMap[s];
+        return id;
     }
     else
     {
@@ -980,39 +2655,56 @@ unsigned int Reader::idFromString(const std::string& s)
     }
 }
 
-void Reader::seekForward(size_t bytes)
+void Reader::seekForward(uint64 bytes)
 {
-    if (m_inRAM)
+    if (m_readAhead)
+    {
+        m_readAhead->seekForward(bytes);
+    }
+    else if (m_blocks)
+    {
+        m_blocks->seekForward(bytes);
+    }
+    else if (m_inRAM)
     {
-        m_inRAMCurrentPos += bytes;
-        if (m_inRAMCurrentPos > m_inRAMSize)
+        if (bytes > m_inRAMSize - m_inRAMCurrentPos)
         {
             m_inRAMCurrentPos = m_inRAMSize;
         }
+        else
+        {
+            m_inRAMCurrentPos += bytes;
+        }
     }
     else if (m_in)
     {
 #ifdef GTO_HAVE_FULL_IOSTREAMS
-        m_in->seekg(bytes, ios_base::cur);
+        m_in->seekg(std::streamoff(bytes), ios_base::cur);
 #else
-        m_in->seekg(bytes, ios::cur);
+        m_in->seekg(std::streamoff(bytes), ios::cur);
 #endif
     }
-#ifdef GTO_SUPPORT_ZIP
-    else
+    else if (m_gzfile)
     {
-        #if ZLIB_VERNUM >= UPDATED_ZLIB_VERNUM
-            gzseek((gzFile_s*)m_gzfile, bytes, SEEK_CUR);
-        #else
-            gzseek(m_gzfile, bytes, SEEK_CUR);
-        #endif
+        m_gzfile->seek(bytes, SEEK_CUR);
+    }
+    else if (m_indexedGz)
+    {
+        m_indexedGz->seek(m_indexedGz->tell() + bytes);
     }
-#endif
 }
 
-void Reader::seekTo(size_t bytes)
+void Reader::seekTo(uint64 bytes)
 {
-    if (m_inRAM)
+    if (m_readAhead)
+    {
+        m_readAhead->seekTo(bytes);
+    }
+    else if (m_blocks)
+    {
+        m_blocks->seekTo(bytes);
+    }
+    else if (m_inRAM)
     {
         if (bytes > m_inRAMSize)
         {
@@ -1023,49 +2715,52 @@ void Reader::seekTo(size_t bytes)
     else if (m_in)
     {
 #ifdef GTO_HAVE_FULL_IOSTREAMS
-        m_in->seekg(bytes, ios_base::beg);
+        m_in->seekg(std::streamoff(bytes), ios_base::beg);
 #else
-        m_in->seekg(bytes, ios::beg);
+        m_in->seekg(std::streamoff(bytes), ios::beg);
 #endif
     }
-#ifdef GTO_SUPPORT_ZIP
-    else
+    else if (m_gzfile)
     {
-        #if ZLIB_VERNUM >= UPDATED_ZLIB_VERNUM
-            gzseek((gzFile_s*)m_gzfile, bytes, SEEK_SET);
-        #else
-            gzseek(m_gzfile, bytes, SEEK_SET);
-        #endif
+        m_gzfile->seek(bytes, SEEK_SET);
+    }
+    else if (m_indexedGz)
+    {
+        m_indexedGz->seek(bytes);
     }
-#endif
 }
 
-int Reader::tell()
+uint64 Reader::tell()
 {
-    if (m_inRAM)
+    if (m_readAhead)
+    {
+        return m_readAhead->tell();
+    }
+    else if (m_blocks)
+    {
+        return m_blocks->tell();
+    }
+    else if (m_inRAM)
     {
         return m_inRAMCurrentPos;
     }
     else if (m_in)
     {
-        return m_in->tellg();
+        return std::streamoff(m_in->tellg());
     }
-#ifdef GTO_SUPPORT_ZIP
-    else
+    else if (m_gzfile)
     {
-        #if ZLIB_VERNUM >= UPDATED_ZLIB_VERNUM
-            return gztell((gzFile_s*)m_gzfile);
-        #else
-            return gztell(m_gzfile);
-        #endif
+        return m_gzfile->tell();
+    }
+    else if (m_indexedGz)
+    {
+        return m_indexedGz->tell();
     }
-#else
     else
     {
         fail("m_in undefined");
         return 0;
     }
-#endif
 }
 
 //----------------------------------------------------------------------
@@ -1134,6 +2829,7 @@ void Reader::addComponent(const ComponentInfo& info)
              i != m_components.end();
              ++i)
         {
+            if (!i->parent) continue;
             size_t offset = i->parent - startAddress;
             i->parent = newStartAddress + offset;
         }
@@ -1171,17 +2867,8 @@ void Reader::beginObject(unsigned int name,
 void Reader::beginComponent(unsigned int nameID,
                             unsigned int interpID)
 {
-
-    ostringstream fullname;
     string name = stringFromId(nameID);
 
-    for (int i = 0; i < m_nameStack.size(); i++)
-    {
-        fullname << m_nameStack[i] << ".";
-    }
-
-    fullname << name;
-
     ComponentInfo info;
     info.name           = nameID;
     info.numProperties  = 0;
@@ -1191,7 +2878,24 @@ void Reader::beginComponent(unsigned int nameID,
     info.poffset        = 0;
     info.object         = &m_objects.back();
     info.childLevel     = m_nameStack.size();
-    info.fullName       = fullname.str();
+    info.parent         = NULL;
+
+    if (!m_indexStack.empty())
+    {
+        size_t first = m_components.size() - m_objects.back().numComponents;
+        info.parent  = &m_components[first + m_indexStack.back()];
+    }
+
+    if (!(m_mode & CompactHeader))
+    {
+        for (int i = 0; i < m_nameStack.size(); i++)
+        {
+            info.fullName += m_nameStack[i];
+            info.fullName += ".";
+        }
+
+        info.fullName += name;
+    }
 
     m_nameStack.push_back(name);
     m_indexStack.push_back(m_objects.back().numComponents);
@@ -1233,10 +2937,16 @@ void Reader::beginProperty(unsigned int name,
     info.size           = 0;
     info.type           = type;
     info.dims           = dims;
+    info.filters        = NoFilter;
+    info.readAs         = type;
     info.component      = &m_components.back();
-    info.fullName       = m_components.back().fullName;
-    info.fullName       += ".";
-    info.fullName       += stringFromId(name);
+
+    if (!(m_mode & CompactHeader))
+    {
+        info.fullName   = m_components.back().fullName;
+        info.fullName   += ".";
+        appendString(info.fullName, name);
+    }
 
     m_components.back().numProperties++;
 
@@ -1252,8 +2962,7 @@ void Reader::beginProperty(unsigned int name,
                              stringFromId(interp),
                              info);
 
-        info.requested    = r.want();
-        info.propertyData = r.data();
+        applyRequest(info, r);
     }
     else
     {
@@ -1317,7 +3026,27 @@ void Reader::endProperty()
     PropertyInfo& info = m_properties.back();
     info.size = numElementsInBuffer();
 
-    if (info.requested)
+    size_t elementBytes = dataSizeInBytes(info.type) * elementSize(info.dims);
+
+    if (info.requested && info.readAs != info.type)
+    {
+        size_t num = m_buffer.size() / dataSizeInBytes(info.type);
+
+        if (void* buffer = data(info, num * dataSizeInBytes(info.readAs)))
+        {
+            convertData(&m_buffer.front(), info.type, buffer, info.readAs, num);
+            dataRead(info);
+        }
+    }
+    else if (info.requested && m_chunkBuffer && elementBytes &&
+             elementBytes <= m_chunkBufferSize)
+    {
+        if (deliverChunks(info, (const char*)&m_buffer.front(), m_buffer.size()))
+        {
+            dataRead(info);
+        }
+    }
+    else if (info.requested)
     {
         if (void* buffer = data(info, m_buffer.size()))
         {
@@ -1331,7 +3060,7 @@ void Reader::endProperty()
 
 void Reader::endFile()
 {
-    m_header.numStrings = m_strings.size();
+    m_header.numStrings = m_stringPool->size();
 }
 
 } // Gto
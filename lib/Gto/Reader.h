@@ -54,11 +54,20 @@ class GTOFlexLexer;
 
 namespace Gto {
 
+class BlockReader;
+class CompressedFile;
+class IndexedGzipFile;
+class ReadAheadStream;
+class StringPool;
+class HashIndex;
+
 //
 //  class Reader
 //
 //  Reads a GTO file as a byte stream or with random access. If compiled
 //  with GTO_SUPPORT_ZIP defined, it can read gzipped gto files directly.
+//  Block compressed files are detected and read transparently; random
+//  access into them only decompresses the blocks which are needed.
 //
 
 class Reader
@@ -89,7 +98,7 @@ public:
     {
         void*                componentData; // return value of component()
         const ObjectInfo*    object;
-        std::string          fullName;
+        std::string          fullName;  // empty with CompactHeader
         const ComponentInfo* parent;
 
         int propertyOffset() const { return poffset; }
@@ -102,14 +111,23 @@ public:
 
     struct PropertyInfo : PropertyHeader
     {
+        uint32               filters;   // PropertyFilter bits (undone by the Reader)
         void*                propertyData;
-        int                  offset;    // file offset
-        std::string          fullName;
+        uint64               offset;    // file offset
+        std::string          fullName;  // empty with CompactHeader
 
         const ComponentInfo* component;
 
+        //
+        //  The type the data is delivered in: the type asked for in the
+        //  Request if it could be converted to, otherwise type.
+        //
+
+        DataType readType() const { return DataType(readAs); }
+
     private:
         bool                 requested;
+        uint32               readAs;
         friend class Reader;
     };
 
@@ -122,6 +140,18 @@ public:
     typedef std::vector<unsigned char> ByteArray;
     typedef std::map<std::string,int>  StringMap;
 
+    //
+    //  A string in the string table without a copy. It points into
+    //  the Reader's storage and is valid until the string table
+    //  changes or the file is closed. data is NUL terminated.
+    //
+
+    struct StringRef
+    {
+        const char*     data;
+        size_t          size;
+    };
+
 
     //
     //  The open modes:
@@ -144,8 +174,36 @@ public:
     //  specifically ask for an object by name -- then they will
     //  called as if the file contained only that data. You can do
     //  this as many times as you want using the accessObject()
-    //  function. RandomAccess implies BinaryOnly.
-    //
+    //  function. RandomAccess implies BinaryOnly. A gzipped file
+    //  with a GzipIndex next to it (see Codec.h) is read through the
+    //  index so seeking doesn't inflate everything in front.
+    //
+    //  MemoryMapped: if the file is an uncompressed binary GTO file it
+    //  will be mapped into memory instead of being read through a
+    //  stream. Property data is offered to dataView() in place (when
+    //  no byte swapping is required) so no copy needs to be made. Files
+    //  which cannot be mapped are read normally. Can be combined with
+    //  the other modes.
+    //
+    //  AsyncIO: batches of properties read with accessProperties()
+    //  from an uncompressed binary file are read with io_uring on
+    //  Linux. data() is called for the whole batch first so each
+    //  buffer must stay valid until its dataRead(). All of the reads
+    //  are in flight at once and complete in any order; dataRead() is
+    //  still called in file order. Ignored where io_uring isn't
+    //  available. Use with RandomAccess.
+    //
+    //  ReadAhead: binary files read straight through are read ahead by
+    //  a background thread into a ring of large buffers (see
+    //  setReadAhead()), so file I/O and gzip decompression overlap with
+    //  the header parsing and the data() and dataRead() callbacks.
+    //  Ignored for block compressed and in memory files and with
+    //  RandomAccess or HeaderOnly.
+    //
+    //  CompactHeader: the fullName of each ComponentInfo and
+    //  PropertyInfo is left empty so the header records hold no heap
+    //  memory of their own. fullName() builds them when they're
+    //  needed. Worth it for files with very many properties.
     //
 
     enum ReadMode
@@ -155,6 +213,10 @@ public:
         RandomAccess     = 1 << 1,
         BinaryOnly       = 1 << 2,
         TextOnly         = 1 << 3,
+        MemoryMapped     = 1 << 4,
+        AsyncIO          = 1 << 5,
+        ReadAhead        = 1 << 6,
+        CompactHeader    = 1 << 7,
     };
 
     explicit Reader(unsigned int mode = None);
@@ -165,6 +227,11 @@ public:
     //  is enabled then open will automatically attempt to find a
     //  gziped version of the file if the file does not exist.
     //
+    //  The in memory open reads an uncompressed binary GTO file from
+    //  the caller's buffer. The buffer must remain valid while the
+    //  file is being read (and until close() if you keep pointers
+    //  handed to dataView()).
+    //
     //  If the mode is RandomAccess, then open will return having only read
     //  the header information.
     //
@@ -187,12 +254,56 @@ public:
     const std::string&  why() const { return m_why; }
 
     const std::string&  stringFromId(unsigned int i);
+
+    //
+    //  The "component.property" style names. Built from the string
+    //  table each time, so they work in CompactHeader mode.
+    //
+
+    std::string         fullName(const ComponentInfo&) const;
+    std::string         fullName(const PropertyInfo&) const;
+
+    StringRef           stringRefFromId(unsigned int i);
     unsigned int        idFromString(const std::string&);
-    const StringTable&  stringTable() { return m_strings; }
+    const StringTable&  stringTable();
 
     bool                isSwapped() const { return m_swapped; }
     unsigned int        readMode() const { return m_mode; }
 
+    //
+    //  Number of threads used to decompress block compressed files
+    //  when streaming. The blocks of requested properties are
+    //  decompressed ahead on a pool of worker threads; data() and
+    //  dataRead() are still called in file order from the calling
+    //  thread. The default is 1 (no worker threads). 0 uses one thread
+    //  per processor. Call before open().
+    //
+
+    void                setNumThreads(size_t n) { m_numThreads = n; }
+    size_t              numThreads() const { return m_numThreads; }
+
+    //
+    //  Opt in to chunked delivery of property data. Instead of calling
+    //  data() for a whole property the reader fills the given buffer
+    //  with as many whole elements as fit, calls dataChunk() and
+    //  repeats until the property has been read. Memory use stays
+    //  constant no matter how large the properties are. A property
+    //  with elements larger than the buffer is read with data() as
+    //  usual. Pass 0 to turn it off.
+    //
+
+    void                setChunkBuffer(void* buffer, size_t bytes)
+                        { m_chunkBuffer = buffer; m_chunkBufferSize = bytes; }
+
+    //
+    //  Size and number of the buffers used by the ReadAhead mode. The
+    //  default is four 4Mb buffers. Call before open().
+    //
+
+    void                setReadAhead(size_t bufferSize, size_t numBuffers = 4)
+                        { m_readAheadSize = bufferSize; 
+                          m_readAheadBuffers = numBuffers; }
+
     const std::string&  infileName() const { return m_inName; }
 
     std::istream*       in() const { return m_in; }
@@ -237,6 +348,40 @@ public:
     Properties&         properties() { return m_properties; }
     bool                accessProperty(PropertyInfo&);
 
+    //
+    //  Find things by name. Components and properties are found by
+    //  their path from the object: "object.component.property". These
+    //  are hash table lookups which work from descriptionComplete()
+    //  on. They return 0 if there is no such thing (or if the file
+    //  has more than one the first is returned).
+    //
+
+    ObjectInfo*         findObject(const std::string& name);
+    ComponentInfo*      findComponent(const std::string& path);
+    PropertyInfo*       findProperty(const std::string& path);
+
+    //
+    //  Reads count elements of the property starting at firstElement.
+    //  data() is asked for a buffer big enough for the slice (not the
+    //  whole property) and dataView() or dataChunk() get just the
+    //  slice. Only the part of the file which holds the slice is read.
+    //  Returns false if the range is not in the property.
+    //
+
+    bool                accessPropertyRange(PropertyInfo&, 
+                                            size_t firstElement,
+                                            size_t count);
+
+    //
+    //  Reads a batch of properties. property() is called for each of
+    //  them first in the order given, then the requested ones are read
+    //  in file order. Properties which are close together in the file
+    //  are read as one sequential run and the runs are announced to
+    //  the operating system (or the block decompressor) ahead of time.
+    //
+
+    bool                accessProperties(const std::vector<PropertyInfo*>&);
+
     //
     //  These are used to declare a component or property. The
     //  functions are called expecting the return value to be non-zero
@@ -244,20 +389,31 @@ public:
     //  data associated with the component or property -- the default
     //  is non-zero.
     //
+    //  A property's Request can also ask for the data to be converted
+    //  to another type as it's read: for example Float for Half or
+    //  Double data, or Int for Short or Byte indices. Any of the number
+    //  types can be converted to any other (see convertData() in
+    //  Utilities.h). data() is then asked for a buffer big enough for
+    //  the converted data and dataView() and dataChunk() aren't used
+    //  for the property. PropertyInfo::readType() says what the data
+    //  will be.
+    //
 
     struct Request
     {
         Request()
-            : m_want(true), m_data(0) {}
-        Request(bool want, void* data = 0)
-            : m_want(want), m_data(data) {}
+            : m_want(true), m_data(0), m_type(ErrorType) {}
+        Request(bool want, void* data = 0, DataType type = ErrorType)
+            : m_want(want), m_data(data), m_type(type) {}
 
-        bool  want() const { return m_want; }
-        void* data() const { return m_data; }
+        bool     want() const { return m_want; }
+        void*    data() const { return m_data; }
+        DataType type() const { return m_type; }
 
     private:
         bool        m_want;
         void*       m_data;
+        DataType    m_type;
         friend class Reader;
     };
 
@@ -300,6 +456,22 @@ public:
 
     virtual void*       data(const PropertyInfo&, size_t bytes);
 
+    //
+    //  dataView() is called instead of data() when the property data
+    //  is already in memory in native byte order and isn't filtered
+    //  (the file was opened MemoryMapped or from an in memory
+    //  buffer). The pointer points
+    //  directly into the mapping or the caller's buffer and is valid
+    //  until close() is called. Return true if you used the data --
+    //  dataRead() will then be called as usual. Returning false (the
+    //  default) will cause the reader to fall back on data() and copy
+    //  into your buffer.
+    //
+
+    virtual bool        dataView(const PropertyInfo&, 
+                                 const void* data, 
+                                 size_t bytes);
+
     //
     //  dataRead() (read "data red") is called after the data is
     //  succesfully read (so after the data() function is called)
@@ -307,6 +479,40 @@ public:
 
     virtual void        dataRead(const PropertyInfo&);
 
+    //
+    //  dataChunk() is called with each chunk of a property when a
+    //  chunk buffer has been set (see setChunkBuffer()). The chunk
+    //  holds count elements starting with element firstElement, in
+    //  native byte order with any filters undone. Return false to skip
+    //  the rest of the property; dataRead() is only called if the
+    //  whole property was delivered.
+    //
+
+    virtual bool        dataChunk(const PropertyInfo&, 
+                                  const void* data,
+                                  size_t firstElement,
+                                  size_t count);
+
+    //
+    //  Components with the Transposed flag store their data as
+    //  records: the first element of each of their properties, then
+    //  the second, etc. By default the reader transposes the records
+    //  back as it reads them and each requested property is delivered
+    //  through data() and dataRead() like any other (dataView() and
+    //  dataChunk() are not used for them). To get the records as they
+    //  are instead return a buffer from transposedData(). It is called
+    //  with the size of all of the records when any of the component's
+    //  properties are requested, and transposedDataRead() is called
+    //  once they've been read (in native byte order). recordSize() and
+    //  fieldOffset() give the layout of the records.
+    //
+
+    virtual void*       transposedData(const ComponentInfo&, size_t bytes);
+    virtual void        transposedDataRead(const ComponentInfo&);
+
+    size_t              recordSize(const ComponentInfo&) const;
+    size_t              fieldOffset(const PropertyInfo&) const;
+
     //------------------------------------------------------------
     //
     //  Text file parser
@@ -369,20 +575,48 @@ protected:
 
 private:
     bool                readBinaryGTO();
+    bool                readBlockGTO();
+    void                prefetchBlocks();
+    void                startReadAhead();
+    void                openGzipIndex();
+    bool                plainFile();
+    void                prefetchRuns(const std::vector<uint64>&);
+    bool                readPropertiesAsync(const std::vector<PropertyInfo*>&);
+    void                readData(char*, size_t, uint32);
+    bool                readTransposedComponent(const ComponentInfo&,
+                                                const std::vector<PropertyInfo*>&);
+    bool                readTransposed(const ComponentInfo&, 
+                                       const std::vector<PropertyInfo*>&,
+                                       size_t);
+    void                swapRecords(const ComponentInfo&, char*, size_t);
+    uint64              recordsOffset(const ComponentInfo&) const;
+    void                decodeProperty(PropertyInfo&, char*, size_t);
+    void                applyRequest(PropertyInfo&, const Request&);
+    bool                readConverted(PropertyInfo&, size_t, size_t, char*, bool);
     bool                readTextGTO();
     void                readMagicNumber();
     void                readHeader();
+    bool                readFooter();
+    bool                readSlice(PropertyInfo&, size_t, size_t, 
+                                  char*, size_t, bool, bool);
+    bool                deliverChunks(PropertyInfo&, const char*, size_t);
     void                readStringTable();
+    bool                validStringId(unsigned int);
+    void                appendString(std::string&, unsigned int);
     void                readObjects();
     void                readComponents();
     void                readProperties();
+    void                buildNameIndex();
+    bool                mapFile(const char*);
+    void                unmapFile();
 
     void                read(char *, size_t);
     void                get(char &);
+    const char*         peek(size_t&);
     bool                notEOF();
-    void                seekForward(size_t);
-    int                 tell();
-    void                seekTo(size_t);
+    void                seekForward(uint64);
+    uint64              tell();
+    void                seekTo(uint64);
 
 private:
     Header              m_header;
@@ -391,14 +625,30 @@ private:
     NameStack           m_nameStack;
     IndexStack          m_indexStack;
     Properties          m_properties;
-    StringTable         m_strings;
-    StringMap           m_stringMap;
+    StringPool*         m_stringPool;
+    HashIndex*          m_objectIndex;
+    HashIndex*          m_componentIndex;
+    HashIndex*          m_propertyIndex;
+    StringTable         m_strings;      // built from the pool on demand
+    std::vector<bool>   m_stringBuilt;
+    size_t              m_numBuilt;
     std::istream*       m_in;
-    char*               m_inRAM;
+    const char*         m_inRAM;
     size_t              m_inRAMSize;
     size_t              m_inRAMCurrentPos;
-    void*               m_gzfile;
+    void*               m_mapping;
+    size_t              m_mappingSize;
+    CompressedFile*     m_gzfile;
+    IndexedGzipFile*    m_indexedGz;
     int                 m_gzrval;
+    BlockReader*        m_blocks;
+    ReadAheadStream*    m_readAhead;
+    size_t              m_readAheadSize;
+    size_t              m_readAheadBuffers;
+    size_t              m_numThreads;
+    void*               m_chunkBuffer;
+    size_t              m_chunkBufferSize;
+    ByteArray           m_filterBlock;
     std::string         m_inName;
     bool                m_needsClosing;
     bool                m_error;
@@ -0,0 +1,231 @@
+//
+//  Copyright (c) 2009, Tweak Software
+//  All rights reserved.
+// 
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//
+//     * Redistributions of source code must retain the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials
+//       provided with the distribution.
+//
+//     * Neither the name of the Tweak Software nor the names of its
+//       contributors may be used to endorse or promote products
+//       derived from this software without specific prior written
+//       permission.
+// 
+//  THIS SOFTWARE IS PROVIDED BY Tweak Software ''AS IS'' AND ANY EXPRESS
+//  OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL Tweak Software BE LIABLE FOR
+//  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+//  OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+//  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+//  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+//  USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+//  DAMAGE.
+
+#include "StringPool.h"
+#include <string.h>
+
+namespace Gto {
+using namespace std;
+
+StringPool::StringPool() : m_pending(0) {}
+
+void
+StringPool::clear()
+{
+    m_arena.clear();
+    m_offsets.clear();
+    m_table.clear();
+    m_pending = 0;
+}
+
+size_t
+StringPool::length(uint32 id) const
+{
+    size_t end = id + 1 < m_offsets.size() ? m_offsets[id + 1] : m_pending;
+    return end - m_offsets[id] - 1;
+}
+
+uint32
+StringPool::hash(const char* s, size_t size, uint32 h)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        h ^= (unsigned char)s[i];
+        h *= 16777619u;
+    }
+
+    return h;
+}
+
+void
+StringPool::rehash(size_t count)
+{
+    size_t n = 16;
+    while (n < count * 2) n *= 2;
+
+    m_table.assign(n, 0);
+    for (uint32 id = 0; id < m_offsets.size(); id++) insert(id);
+}
+
+void
+StringPool::insert(uint32 id)
+{
+    const char*  s    = data(id);
+    const size_t size = length(id);
+    const size_t mask = m_table.size() - 1;
+
+    for (size_t i = hash(s, size) & mask;; i = (i + 1) & mask)
+    {
+        uint32 slot = m_table[i];
+
+        if (!slot)
+        {
+            m_table[i] = id + 1;
+            return;
+        }
+
+        //
+        //  The first of any duplicates wins
+        //
+
+        if (length(slot - 1) == size && !memcmp(data(slot - 1), s, size)) return;
+    }
+}
+
+int
+StringPool::find(const char* s, size_t size) const
+{
+    if (m_table.empty()) return -1;
+    const size_t mask = m_table.size() - 1;
+
+    for (size_t i = hash(s, size) & mask;; i = (i + 1) & mask)
+    {
+        uint32 slot = m_table[i];
+        if (!slot) return -1;
+
+        if (length(slot - 1) == size && !memcmp(data(slot - 1), s, size))
+        {
+            return int(slot - 1);
+        }
+    }
+}
+
+size_t
+StringPool::append(const char* data, size_t bytes, size_t count)
+{
+    //
+    //  Only the offsets are recorded, the strings stay where they land
+    //
+
+    const size_t first = m_offsets.size();
+    const size_t base  = m_arena.size();
+    const char*  end   = data + bytes;
+    const char*  p     = data;
+
+    while (count && p < end)
+    {
+        const char* q = (const char*)memchr(p, 0, end - p);
+
+        if (!q)
+        {
+            if (p != data) m_pending = base + (p - data);
+            p = end;
+            break;
+        }
+
+        m_offsets.push_back(uint32(p == data ? m_pending : base + (p - data)));
+        p = q + 1;
+        count--;
+        m_pending = base + (p - data);
+    }
+
+    m_arena.insert(m_arena.end(), data, p);
+    index(first);
+    return p - data;
+}
+
+void
+StringPool::index(size_t first)
+{
+    if (m_offsets.size() * 2 > m_table.size())
+    {
+        rehash(m_offsets.size());
+    }
+    else
+    {
+        for (size_t id = first; id < m_offsets.size(); id++) insert(uint32(id));
+    }
+}
+
+uint32
+StringPool::intern(const char* s, size_t size)
+{
+    int id = find(s, size);
+    if (id >= 0) return uint32(id);
+
+    m_offsets.push_back(uint32(m_arena.size()));
+    m_arena.insert(m_arena.end(), s, s + size);
+    m_arena.push_back(0);
+    m_pending = m_arena.size();
+    index(m_offsets.size() - 1);
+    return uint32(m_offsets.size() - 1);
+}
+
+//----------------------------------------------------------------------
+
+void
+HashIndex::init(size_t count)
+{
+    size_t n = 16;
+    while (n < count * 2) n *= 2;
+
+    Entry empty = { 0, 0 };
+    m_table.assign(n, empty);
+}
+
+void
+HashIndex::insert(uint32 hash, uint32 value)
+{
+    const size_t mask = m_table.size() - 1;
+    size_t       i    = hash & mask;
+
+    while (m_table[i].value) i = (i + 1) & mask;
+
+    m_table[i].hash  = hash;
+    m_table[i].value = value + 1;
+}
+
+int
+HashIndex::find(uint32 hash, size_t& slot) const
+{
+    if (m_table.empty()) return -1;
+    slot = (hash & (m_table.size() - 1)) - 1;
+    return next(hash, slot);
+}
+
+int
+HashIndex::next(uint32 hash, size_t& slot) const
+{
+    const size_t mask = m_table.size() - 1;
+
+    for (slot = (slot + 1) & mask; m_table[slot].value; slot = (slot + 1) & mask)
+    {
+        if (m_table[slot].hash == hash) return int(m_table[slot].value - 1);
+    }
+
+    return -1;
+}
+
+} // Gto
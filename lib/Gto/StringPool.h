@@ -0,0 +1,139 @@
+//
+//  Copyright (c) 2009, Tweak Software
+//  All rights reserved.
+// 
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//
+//     * Redistributions of source code must retain the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials
+//       provided with the distribution.
+//
+//     * Neither the name of the Tweak Software nor the names of its
+//       contributors may be used to endorse or promote products
+//       derived from this software without specific prior written
+//       permission.
+// 
+//  THIS SOFTWARE IS PROVIDED BY Tweak Software ''AS IS'' AND ANY EXPRESS
+//  OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL Tweak Software BE LIABLE FOR
+//  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+//  OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+//  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+//  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+//  USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+//  DAMAGE.
+
+#ifndef __Gto__StringPool__h__
+#define __Gto__StringPool__h__
+#include <Gto/Header.h>
+#include <sys/types.h>
+#include <string>
+#include <vector>
+
+namespace Gto {
+
+//
+//  class StringPool
+//
+//  The Reader's string table. All of the strings are kept NUL
+//  terminated in one block of memory and are found by id or by
+//  hashed lookup. Raw string table bytes can be appended as they come
+//  off the file and are split in place.
+//
+
+class StringPool
+{
+public:
+    StringPool();
+
+    void                clear();
+
+    //
+    //  Appends up to count NUL terminated strings from data and
+    //  returns the number of bytes used. If the last one isn't
+    //  terminated it is finished by the next call.
+    //
+
+    size_t              append(const char* data, size_t bytes, size_t count);
+
+    //
+    //  Returns the id of the string, adding it if it isn't there
+    //
+
+    uint32              intern(const char* s, size_t size);
+
+    //
+    //  Returns the id of the string or -1
+    //
+
+    int                 find(const char* s, size_t size) const;
+
+    size_t              size() const { return m_offsets.size(); }
+    const char*         data(uint32 id) const { return &m_arena[m_offsets[id]]; }
+    size_t              length(uint32 id) const;
+
+    //
+    //  FNV-1a. Longer strings can be hashed a piece at a time by
+    //  passing in the hash of what came before.
+    //
+
+    static const uint32 HashSeed = 2166136261u;
+    static uint32       hash(const char*, size_t, uint32 h = HashSeed);
+
+private:
+    void                insert(uint32 id);
+    void                rehash(size_t);
+    void                index(size_t first);
+
+private:
+    std::vector<char>   m_arena;
+    std::vector<uint32> m_offsets;
+    std::vector<uint32> m_table;    // id + 1 or 0 if empty
+    size_t              m_pending;  // start of an unterminated string
+};
+
+//
+//  class HashIndex
+//
+//  Maps hashes to values. The keys aren't stored: the caller compares
+//  each value find() and next() come up with against what it's looking
+//  for. Values with the same key come out in the order they went in.
+//
+
+class HashIndex
+{
+public:
+    void                clear() { m_table.clear(); }
+    void                init(size_t count);
+    void                insert(uint32 hash, uint32 value);
+
+    //
+    //  Return -1 when there are no more
+    //
+
+    int                 find(uint32 hash, size_t& slot) const;
+    int                 next(uint32 hash, size_t& slot) const;
+
+private:
+    struct Entry
+    {
+        uint32          hash;
+        uint32          value;      // value + 1 or 0 if empty
+    };
+
+    std::vector<Entry>  m_table;
+};
+
+} // Gto
+
+#endif // __Gto__StringPool__h__
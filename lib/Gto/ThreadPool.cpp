@@ -0,0 +1,178 @@
+//
+//  Copyright (c) 2009, Tweak Software
+//  All rights reserved.
+// 
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//
+//     * Redistributions of source code must retain the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials
+//       provided with the distribution.
+//
+//     * Neither the name of the Tweak Software nor the names of its
+//       contributors may be used to endorse or promote products
+//       derived from this software without specific prior written
+//       permission.
+// 
+//  THIS SOFTWARE IS PROVIDED BY Tweak Software ''AS IS'' AND ANY EXPRESS
+//  OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL Tweak Software BE LIABLE FOR
+//  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+//  OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+//  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+//  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+//  USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+//  DAMAGE.
+
+#include "ThreadPool.h"
+#include <algorithm>
+#include <unistd.h>
+
+namespace Gto {
+using namespace std;
+
+ThreadPool::ThreadPool(size_t numThreads)
+    : m_numThreads(numThreads ? numThreads : numProcessors()),
+      m_quit(false)
+{
+#ifdef GTO_SUPPORT_PTHREADS
+    pthread_mutex_init(&m_mutex, 0);
+    pthread_cond_init(&m_jobAdded, 0);
+    pthread_cond_init(&m_jobDone, 0);
+
+    for (size_t i = 0; i < m_numThreads; i++)
+    {
+        pthread_t thread;
+
+        if (pthread_create(&thread, 0, threadMain, this) == 0)
+        {
+            m_threads.push_back(thread);
+        }
+    }
+
+    m_numThreads = m_threads.size();
+#endif
+}
+
+ThreadPool::~ThreadPool()
+{
+#ifdef GTO_SUPPORT_PTHREADS
+    pthread_mutex_lock(&m_mutex);
+    m_quit = true;
+    pthread_cond_broadcast(&m_jobAdded);
+    pthread_mutex_unlock(&m_mutex);
+
+    for (size_t i = 0; i < m_threads.size(); i++)
+    {
+        pthread_join(m_threads[i], 0);
+    }
+
+    pthread_cond_destroy(&m_jobDone);
+    pthread_cond_destroy(&m_jobAdded);
+    pthread_mutex_destroy(&m_mutex);
+#endif
+}
+
+size_t
+ThreadPool::numProcessors()
+{
+#ifdef _SC_NPROCESSORS_ONLN
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? size_t(n) : 1;
+#else
+    return 1;
+#endif
+}
+
+void*
+ThreadPool::threadMain(void* pool)
+{
+    reinterpret_cast<ThreadPool*>(pool)->work();
+    return 0;
+}
+
+void
+ThreadPool::work()
+{
+#ifdef GTO_SUPPORT_PTHREADS
+    pthread_mutex_lock(&m_mutex);
+
+    while (true)
+    {
+        while (m_jobs.empty() && !m_quit)
+        {
+            pthread_cond_wait(&m_jobAdded, &m_mutex);
+        }
+
+        if (m_jobs.empty()) break;
+
+        Job* job = m_jobs.front();
+        m_jobs.pop_front();
+        pthread_mutex_unlock(&m_mutex);
+
+        job->run();
+
+        pthread_mutex_lock(&m_mutex);
+        job->m_done = true;
+        pthread_cond_broadcast(&m_jobDone);
+    }
+
+    pthread_mutex_unlock(&m_mutex);
+#endif
+}
+
+void
+ThreadPool::add(Job* job)
+{
+    job->m_done = false;
+
+#ifdef GTO_SUPPORT_PTHREADS
+    if (m_numThreads)
+    {
+        pthread_mutex_lock(&m_mutex);
+        m_jobs.push_back(job);
+        pthread_cond_signal(&m_jobAdded);
+        pthread_mutex_unlock(&m_mutex);
+        return;
+    }
+#endif
+
+    m_jobs.push_back(job);
+}
+
+void
+ThreadPool::wait(Job* job)
+{
+#ifdef GTO_SUPPORT_PTHREADS
+    if (m_numThreads)
+    {
+        pthread_mutex_lock(&m_mutex);
+        while (!job->m_done) pthread_cond_wait(&m_jobDone, &m_mutex);
+        pthread_mutex_unlock(&m_mutex);
+        return;
+    }
+#endif
+
+    //
+    //  No threads: run everything queued up to and including the job
+    //
+
+    while (!job->m_done && !m_jobs.empty())
+    {
+        Job* j = m_jobs.front();
+        m_jobs.pop_front();
+        j->run();
+        j->m_done = true;
+    }
+}
+
+} // Gto
@@ -0,0 +1,104 @@
+//
+//  Copyright (c) 2009, Tweak Software
+//  All rights reserved.
+// 
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//
+//     * Redistributions of source code must retain the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials
+//       provided with the distribution.
+//
+//     * Neither the name of the Tweak Software nor the names of its
+//       contributors may be used to endorse or promote products
+//       derived from this software without specific prior written
+//       permission.
+// 
+//  THIS SOFTWARE IS PROVIDED BY Tweak Software ''AS IS'' AND ANY EXPRESS
+//  OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL Tweak Software BE LIABLE FOR
+//  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+//  OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+//  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+//  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+//  USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+//  DAMAGE.
+
+#ifndef __Gto__ThreadPool__h__
+#define __Gto__ThreadPool__h__
+#include <sys/types.h>
+#include <deque>
+#include <vector>
+#ifdef GTO_SUPPORT_PTHREADS
+#include <pthread.h>
+#endif
+
+namespace Gto {
+
+//
+//  class ThreadPool
+//
+//  A minimal pool of worker threads used internally by the Reader and
+//  Writer. Jobs are run in the order they are added. The pool does not
+//  own the jobs: the caller must wait() for a job before deleting it.
+//
+//  If the library is compiled without GTO_SUPPORT_PTHREADS the jobs
+//  are run by the calling thread in wait().
+//
+
+class ThreadPool
+{
+public:
+    struct Job
+    {
+        Job() : m_done(false) {}
+        virtual ~Job() {}
+        virtual void run() = 0;
+
+    private:
+        bool m_done;
+        friend class ThreadPool;
+    };
+
+    //
+    //  A numThreads of 0 uses one thread per processor
+    //
+
+    explicit ThreadPool(size_t numThreads = 0);
+    ~ThreadPool();
+
+    void            add(Job*);
+    void            wait(Job*);
+
+    size_t          numThreads() const { return m_numThreads; }
+
+    static size_t   numProcessors();
+
+private:
+    void            work();
+    static void*    threadMain(void*);
+
+private:
+    size_t              m_numThreads;
+    std::deque<Job*>    m_jobs;
+    bool                m_quit;
+#ifdef GTO_SUPPORT_PTHREADS
+    std::vector<pthread_t> m_threads;
+    pthread_mutex_t     m_mutex;
+    pthread_cond_t      m_jobAdded;
+    pthread_cond_t      m_jobDone;
+#endif
+};
+
+} // Gto
+
+#endif // __Gto__ThreadPool__h__
@@ -34,13 +34,18 @@
 //  DAMAGE.
 //
 #include <Gto/Utilities.h>
+#include <Gto/Codec.h>
 #include <assert.h>
 #include <fstream>
-#ifdef GTO_SUPPORT_ZIP
-#include <zlib.h>
-#endif
-#ifdef GTO_SUPPORT_HALF
-#include <half.h>
+#include <algorithm>
+#include <string.h>
+#include <limits>
+#if defined(__AVX2__) || defined(__F16C__)
+#include <immintrin.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
 #endif
 #include <stdlib.h>
 
@@ -52,11 +57,7 @@ static unsigned int Csizes[] =
     Int,        sizeof(int32),
     Float,      sizeof(float32),
     Double,     sizeof(float64),
-#ifdef GTO_SUPPORT_HALF
-    Half,       sizeof(half),
-#else
-    Half,       sizeof(float32) / 2,
-#endif
+    Half,       sizeof(uint16),
     String,     sizeof(uint32),
     Boolean,    sizeof(uint8), 
     Short,      sizeof(uint16),
@@ -136,12 +137,10 @@ asNumber(void* data, Gto::DataType t)
           n._double = *reinterpret_cast<double*>(data);
           n.type = Double;
           break;
-#ifdef GTO_SUPPORT_HALF
       case Half: 
-          n._double = double(*reinterpret_cast<half*>(data));
+          n._double = halfToFloat(*reinterpret_cast<uint16*>(data));
           n.type = Float;
           break;
-#endif
       case Int: 
           n._int = int(*reinterpret_cast<int*>(data));
           n.type = Int;
@@ -165,30 +164,810 @@ bool isGTOFile(const char* infile)
 {
     Header header;
 
-#ifdef GTO_SUPPORT_ZIP
-    if (gzFile file = gzopen(infile, "rb"))
+    if (CompressedFile::supported())
     {
-        if (gzread(file, &header, sizeof(header)) != sizeof(Header))
-        {
-            gzclose(file);
-            return false;
-        }
+        CompressedFile file;
+        if (!file.open(infile, "rb")) return false;
+        if (file.read(&header, sizeof(Header)) != sizeof(Header)) return false;
+    }
+    else
+    {
+        ifstream file(infile);
+        if (!file) return false;
+        if (file.readsome((char*)&header, sizeof(Header)) != sizeof(Header)) return false;
+        if (file.fail()) return false;
     }
-#else
-    ifstream file(infile);
-    if (!file) return false;
-    if (file.readsome((char*)&header, sizeof(Header)) != sizeof(Header)) return false;
-    if (file.fail()) return false;
-#endif
 
     return  header.magic == GTO_MAGIC ||
             header.magic == GTO_MAGICl ||
             header.magic == GTO_MAGIC_TEXT ||
-            header.magic == GTO_MAGIC_TEXTl;
+            header.magic == GTO_MAGIC_TEXTl ||
+            header.magic == GTO_MAGIC_BLOCK ||
+            header.magic == GTO_MAGIC_BLOCKl;
 }
 
 void splitComponentName(const char* name, vector<string>& buffer)
 {
 }
 
+uint32
+filtersForType(uint32 type)
+{
+    switch (type)
+    {
+      case Int:
+      case Short:
+          return ShuffleFilter | DeltaFilter;
+      case Float:
+      case Double:
+      case Half:
+          return ShuffleFilter;
+      case Byte:
+          return DeltaFilter;
+      default:
+          return NoFilter;
+    }
+}
+
+//
+//  Shuffling stores the first byte of every value in the block, then
+//  the second, etc. The high bytes of floats which are close to each
+//  other are usually the same so the result compresses much better.
+//
+
+void
+shuffleBytes(void* data, size_t bytes, size_t wordSize)
+{
+    if (wordSize < 2) return;
+
+    unsigned char* p = (unsigned char*)data;
+    vector<unsigned char> temp(std::min(bytes, size_t(GTO_FILTER_BLOCK)));
+
+    for (size_t offset = 0; offset < bytes; offset += GTO_FILTER_BLOCK)
+    {
+        size_t n = std::min(bytes - offset, size_t(GTO_FILTER_BLOCK)) / wordSize;
+        unsigned char* block = p + offset;
+
+        for (size_t i = 0; i < n; i++)
+        {
+            for (size_t b = 0; b < wordSize; b++)
+            {
+                temp[b * n + i] = block[i * wordSize + b];
+            }
+        }
+
+        memcpy(block, &temp.front(), n * wordSize);
+    }
+}
+
+void
+unshuffleBytes(void* data, size_t bytes, size_t wordSize)
+{
+    if (wordSize < 2) return;
+
+    unsigned char* p = (unsigned char*)data;
+    vector<unsigned char> temp(std::min(bytes, size_t(GTO_FILTER_BLOCK)));
+
+    for (size_t offset = 0; offset < bytes; offset += GTO_FILTER_BLOCK)
+    {
+        size_t n = std::min(bytes - offset, size_t(GTO_FILTER_BLOCK)) / wordSize;
+        unsigned char* block = p + offset;
+
+        for (size_t i = 0; i < n; i++)
+        {
+            for (size_t b = 0; b < wordSize; b++)
+            {
+                temp[i * wordSize + b] = block[b * n + i];
+            }
+        }
+
+        memcpy(block, &temp.front(), n * wordSize);
+    }
+}
+
+//
+//  Each value is replaced with its difference from the previous
+//  one. The first value of each block is stored as is.
+//
+
+template <typename T>
+static void
+deltaEncodeT(T* data, size_t n)
+{
+    const size_t perBlock = GTO_FILTER_BLOCK / sizeof(T);
+
+    for (size_t i = n; i-- > 0;)
+    {
+        if (i % perBlock) data[i] -= data[i - 1];
+    }
+}
+
+template <typename T>
+static void
+deltaDecodeT(T* data, size_t n)
+{
+    const size_t perBlock = GTO_FILTER_BLOCK / sizeof(T);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        if (i % perBlock) data[i] += data[i - 1];
+    }
+}
+
+void
+deltaEncode(void* data, size_t bytes, size_t wordSize)
+{
+    switch (wordSize)
+    {
+      case 1: deltaEncodeT((uint8*)data, bytes); break;
+      case 2: deltaEncodeT((uint16*)data, bytes / 2); break;
+      case 4: deltaEncodeT((uint32*)data, bytes / 4); break;
+      case 8: deltaEncodeT((uint64*)data, bytes / 8); break;
+    }
+}
+
+void
+deltaDecode(void* data, size_t bytes, size_t wordSize)
+{
+    switch (wordSize)
+    {
+      case 1: deltaDecodeT((uint8*)data, bytes); break;
+      case 2: deltaDecodeT((uint16*)data, bytes / 2); break;
+      case 4: deltaDecodeT((uint32*)data, bytes / 4); break;
+      case 8: deltaDecodeT((uint64*)data, bytes / 8); break;
+    }
+}
+
+//----------------------------------------------------------------------
+//
+//  Byte swapping
+//
+//  The values are reversed 16 or 32 bytes at a time with a byte
+//  shuffle when the library is built for SSSE3 or AVX2 (-mssse3,
+//  -mavx2). Plain SSE2 has no byte shuffle so it swaps the bytes of
+//  each 16 bit word with shifts and then reorders the words. The tail
+//  (and other CPUs) use scalar swaps the compiler turns into bswap.
+//
+
+#if defined(__SSSE3__) || defined(__AVX2__)
+static const char swapMasks[3][16] = 
+{
+    { 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14 },
+    { 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12 },
+    { 7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8 }
+};
+#endif
+
+static inline uint32
+swap32(uint32 v)
+{
+    return (v >> 24) | ((v >> 8) & 0xff00) | ((v << 8) & 0xff0000) | (v << 24);
+}
+
+static void
+swapBytes(const char* in, char* out, size_t num, size_t wordSize)
+{
+    const size_t bytes = num * wordSize;
+    size_t       i     = 0;
+
+#if defined(__SSSE3__) || defined(__AVX2__)
+    const __m128i mask = 
+        _mm_loadu_si128((const __m128i*)swapMasks[wordSize >> 2]);
+
+#ifdef __AVX2__
+    const __m256i mask2 = _mm256_broadcastsi128_si256(mask);
+
+    for (; i + 32 <= bytes; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(in + i));
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_shuffle_epi8(v, mask2));
+    }
+#endif
+
+    for (; i + 16 <= bytes; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(in + i));
+        _mm_storeu_si128((__m128i*)(out + i), _mm_shuffle_epi8(v, mask));
+    }
+#elif defined(__SSE2__)
+    for (; i + 16 <= bytes; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(in + i));
+        v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+
+        if (wordSize == 4)
+        {
+            v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xb1), 0xb1);
+        }
+        else if (wordSize == 8)
+        {
+            v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0x1b), 0x1b);
+        }
+
+        _mm_storeu_si128((__m128i*)(out + i), v);
+    }
+#endif
+
+    for (; i < bytes; i += wordSize)
+    {
+        switch (wordSize)
+        {
+          case 2:
+          {
+              uint16 v;
+              memcpy(&v, in + i, 2);
+              v = uint16((v >> 8) | (v << 8));
+              memcpy(out + i, &v, 2);
+              break;
+          }
+          case 4:
+          {
+              uint32 v;
+              memcpy(&v, in + i, 4);
+              v = swap32(v);
+              memcpy(out + i, &v, 4);
+              break;
+          }
+          case 8:
+          {
+              uint32 v[2];
+              memcpy(v, in + i, 8);
+              uint32 t = swap32(v[0]);
+              v[0] = swap32(v[1]);
+              v[1] = t;
+              memcpy(out + i, v, 8);
+              break;
+          }
+        }
+    }
+}
+
+void
+swapData(void* data, size_t num, uint32 type)
+{
+    size_t wordSize = dataSizeInBytes(type);
+    if (wordSize > 1) swapBytes((const char*)data, (char*)data, num, wordSize);
+}
+
+void
+swapCopy(const void* in, void* out, size_t num, uint32 type)
+{
+    size_t wordSize = dataSizeInBytes(type);
+
+    if (wordSize > 1) swapBytes((const char*)in, (char*)out, num, wordSize);
+    else memcpy(out, in, num);
+}
+
+//----------------------------------------------------------------------
+//
+//  Transposed records
+//
+//  The common field sizes get a loop with a constant size memcpy which
+//  the compiler turns into a single load and store.
+//
+
+template <size_t N>
+static void
+copyStridedN(const char* in, size_t inStride, char* out, size_t outStride, size_t count)
+{
+    for (size_t i = 0; i < count; i++, in += inStride, out += outStride)
+    {
+        memcpy(out, in, N);
+    }
+}
+
+static void
+copyStrided(const char* in, size_t inStride, 
+            char* out, size_t outStride, 
+            size_t bytes, size_t count)
+{
+    switch (bytes)
+    {
+      case 1:  copyStridedN<1>(in, inStride, out, outStride, count); break;
+      case 2:  copyStridedN<2>(in, inStride, out, outStride, count); break;
+      case 4:  copyStridedN<4>(in, inStride, out, outStride, count); break;
+      case 8:  copyStridedN<8>(in, inStride, out, outStride, count); break;
+      case 12: copyStridedN<12>(in, inStride, out, outStride, count); break;
+      case 16: copyStridedN<16>(in, inStride, out, outStride, count); break;
+      case 24: copyStridedN<24>(in, inStride, out, outStride, count); break;
+      case 32: copyStridedN<32>(in, inStride, out, outStride, count); break;
+      case 64: copyStridedN<64>(in, inStride, out, outStride, count); break;
+      default:
+          for (size_t i = 0; i < count; i++, in += inStride, out += outStride)
+          {
+              memcpy(out, in, bytes);
+          }
+    }
+}
+
+void
+packField(const void* data, size_t fieldBytes, 
+          void* records, size_t recordBytes, size_t fieldOffset,
+          size_t count)
+{
+    copyStrided((const char*)data, fieldBytes, 
+                (char*)records + fieldOffset, recordBytes,
+                fieldBytes, count);
+}
+
+void
+unpackField(const void* records, size_t recordBytes, size_t fieldOffset,
+            void* data, size_t fieldBytes,
+            size_t count)
+{
+    copyStrided((const char*)records + fieldOffset, recordBytes,
+                (char*)data, fieldBytes, 
+                fieldBytes, count);
+}
+
+//----------------------------------------------------------------------
+//
+//  Half floats
+//
+//  The scalar conversions are table driven (after van der Zijp's "Fast
+//  Half Float Conversions"). A half becomes a float with two lookups
+//  and an add. A float becomes a half with a lookup and a shift by its
+//  exponent, rounded to nearest even. Floats too large for a half
+//  become infinity and NaNs stay NaNs.
+//
+//  The array conversions use the F16C instructions when the library is
+//  built for them (-mf16c). Plain SSE2 does the same arithmetic as the
+//  tables four values at a time with a multiply (half to float) or an
+//  add (float to half) which lets the FPU do the denormals and the
+//  rounding.
+//
+
+struct HalfTables
+{
+    HalfTables();
+
+    uint32 mantissa[2048];  // half to float
+    uint32 exponent[64];
+    uint16 offset[64];
+    uint16 base[512];       // float to half
+    uint8  shift[512];
+};
+
+HalfTables::HalfTables()
+{
+    //
+    //  Denormal halfs are normalized, the others only need their
+    //  mantissas moved and their exponents rebiased
+    //
+
+    mantissa[0] = 0;
+
+    for (uint32 i = 1; i < 1024; i++)
+    {
+        uint32 m = i << 13;
+        uint32 e = 0x38800000;
+        while (!(m & 0x00800000)) { m <<= 1; e -= 0x00800000; }
+        mantissa[i] = e | (m & ~0x00800000);
+    }
+
+    for (uint32 i = 1024; i < 2048; i++)
+    {
+        mantissa[i] = 0x38000000 + ((i - 1024) << 13);
+    }
+
+    for (uint32 i = 0; i < 32; i++)
+    {
+        exponent[i]      = i << 23;
+        exponent[i + 32] = 0x80000000 | (i << 23);
+        offset[i]        = 1024;
+        offset[i + 32]   = 1024;
+    }
+
+    exponent[31] = 0x47800000;          // inf and nan
+    exponent[63] = 0xc7800000;
+    offset[0]    = 0;
+    offset[32]   = 0;
+
+    //
+    //  The float's mantissa (with its implicit bit) is shifted down
+    //  into the half's and added to the base. A shift of 25 leaves
+    //  nothing of it: the value is either too small for a half or too
+    //  large.
+    //
+
+    for (uint32 i = 0; i < 256; i++)
+    {
+        if (i < 102)
+        {
+            base[i]  = 0;
+            shift[i] = 25;
+        }
+        else if (i < 113)
+        {
+            base[i]  = 0;               // denormal
+            shift[i] = uint8(126 - i);
+        }
+        else if (i < 143)
+        {
+            base[i]  = uint16((i - 113) << 10);
+            shift[i] = 13;
+        }
+        else
+        {
+            base[i]  = 0x7c00;          // inf
+            shift[i] = 25;
+        }
+
+        base[i | 0x100]  = base[i] | 0x8000;
+        shift[i | 0x100] = shift[i];
+    }
+}
+
+static const HalfTables&
+halfTables()
+{
+    static HalfTables tables;
+    return tables;
+}
+
+static inline uint32
+halfBits(const HalfTables& t, uint16 h)
+{
+    return t.mantissa[t.offset[h >> 10] + (h & 0x3ff)] + t.exponent[h >> 10];
+}
+
+static inline uint16
+floatBits(const HalfTables& t, uint32 bits)
+{
+    if ((bits & 0x7fffffff) > 0x7f800000)
+    {
+        return uint16(((bits >> 16) & 0x8000) | 0x7e00);   // nan
+    }
+
+    const uint32 i    = bits >> 23;
+    const uint32 s    = t.shift[i];
+    const uint32 m    = (bits & 0x7fffff) | 0x800000;
+    const uint32 rest = m & ((1u << s) - 1);
+    const uint32 mid  = 1u << (s - 1);
+    uint32       h    = t.base[i] + (m >> s);
+
+    //
+    //  A carry out of the mantissa moves the exponent up, which is
+    //  what's wanted (up to inf)
+    //
+
+    if (rest > mid || (rest == mid && (h & 1))) h++;
+    return uint16(h);
+}
+
+float32
+halfToFloat(uint16 h)
+{
+    uint32  bits = halfBits(halfTables(), h);
+    float32 f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+uint16
+floatToHalf(float32 f)
+{
+    uint32 bits;
+    memcpy(&bits, &f, sizeof(bits));
+    return floatBits(halfTables(), bits);
+}
+
+#if defined(__SSE2__) && !defined(__F16C__)
+
+//
+//  h holds a half in the low 16 bits of each 32 bit word
+//
+
+static inline __m128
+halfToFloat4(__m128i h)
+{
+    const __m128i expmant  = _mm_and_si128(h, _mm_set1_epi32(0x7fff));
+    const __m128i sign     = _mm_slli_epi32(_mm_xor_si128(h, expmant), 16);
+    const __m128  scale    = _mm_castsi128_ps(_mm_set1_epi32((254 - 15) << 23));
+    const __m128  scaled   = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(expmant, 13)), 
+                                        scale);
+    const __m128i infnan   = _mm_cmpgt_epi32(expmant, _mm_set1_epi32(0x7bff));
+    const __m128  infnanExp = _mm_and_ps(_mm_castsi128_ps(infnan), 
+                                         _mm_castsi128_ps(_mm_set1_epi32(255 << 23)));
+
+    return _mm_or_ps(scaled, _mm_or_ps(_mm_castsi128_ps(sign), infnanExp));
+}
+
+//
+//  Returns the halfs sign extended to 32 bits so two results can be
+//  packed together with _mm_packs_epi32()
+//
+
+static inline __m128i
+floatToHalf4(__m128 f)
+{
+    const __m128  justSign  = _mm_and_ps(f, _mm_castsi128_ps(_mm_set1_epi32(0x80000000)));
+    const __m128  absf      = _mm_xor_ps(f, justSign);
+    const __m128i absi      = _mm_castps_si128(absf);
+    const __m128i isNan     = _mm_castps_si128(_mm_cmpunord_ps(absf, absf));
+    const __m128i isRegular = _mm_cmpgt_epi32(_mm_set1_epi32((127 + 16) << 23), absi);
+    const __m128i isDenorm  = _mm_cmpgt_epi32(_mm_set1_epi32((127 - 14) << 23), absi);
+    const __m128i special   = _mm_or_si128(_mm_and_si128(isNan, _mm_set1_epi32(0x200)),
+                                           _mm_set1_epi32(0x7c00));
+
+    //
+    //  Adding 0.5 puts the denormal's mantissa in the low bits of the
+    //  float, rounded by the FPU
+    //
+
+    const __m128i magic     = _mm_set1_epi32((127 - 1) << 23);
+    const __m128i denorm    = _mm_sub_epi32(_mm_castps_si128(
+                                  _mm_add_ps(absf, _mm_castsi128_ps(magic))), magic);
+
+    //
+    //  Normal values are rebiased and rounded up by 0xfff, or by 0x1000
+    //  if the result would be odd
+    //
+
+    const __m128i odd       = _mm_srai_epi32(_mm_slli_epi32(absi, 18), 31);
+    const __m128i bias      = _mm_set1_epi32(0xfff - ((127 - 15) << 23));
+    const __m128i normal    = _mm_srli_epi32(_mm_sub_epi32(_mm_add_epi32(absi, bias), 
+                                                           odd), 13);
+
+    const __m128i finite    = _mm_or_si128(_mm_and_si128(isDenorm, denorm),
+                                           _mm_andnot_si128(isDenorm, normal));
+    const __m128i joined    = _mm_or_si128(_mm_and_si128(isRegular, finite),
+                                           _mm_andnot_si128(isRegular, special));
+
+    return _mm_or_si128(joined, _mm_srai_epi32(_mm_castps_si128(justSign), 16));
+}
+
+#endif
+
+void
+halfToFloat(const void* in, void* out, size_t num)
+{
+    const char* i = (const char*)in;
+    char*       o = (char*)out;
+    size_t      n = 0;
+
+#if defined(__F16C__)
+    for (; n + 8 <= num; n += 8)
+    {
+        __m128i h = _mm_loadu_si128((const __m128i*)(i + n * 2));
+        _mm256_storeu_ps((float*)(o + n * 4), _mm256_cvtph_ps(h));
+    }
+#elif defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+
+    for (; n + 8 <= num; n += 8)
+    {
+        __m128i h = _mm_loadu_si128((const __m128i*)(i + n * 2));
+        _mm_storeu_ps((float*)(o + n * 4), halfToFloat4(_mm_unpacklo_epi16(h, zero)));
+        _mm_storeu_ps((float*)(o + n * 4 + 16), halfToFloat4(_mm_unpackhi_epi16(h, zero)));
+    }
+#endif
+
+    const HalfTables& t = halfTables();
+
+    for (; n < num; n++)
+    {
+        uint16 h;
+        memcpy(&h, i + n * 2, 2);
+        uint32 bits = halfBits(t, h);
+        memcpy(o + n * 4, &bits, 4);
+    }
+}
+
+void
+floatToHalf(const void* in, void* out, size_t num)
+{
+    const char* i = (const char*)in;
+    char*       o = (char*)out;
+    size_t      n = 0;
+
+#if defined(__F16C__)
+    for (; n + 8 <= num; n += 8)
+    {
+        __m256 f = _mm256_loadu_ps((const float*)(i + n * 4));
+        _mm_storeu_si128((__m128i*)(o + n * 2), 
+                         _mm256_cvtps_ph(f, _MM_FROUND_TO_NEAREST_INT));
+    }
+#elif defined(__SSE2__)
+    for (; n + 8 <= num; n += 8)
+    {
+        __m128i a = floatToHalf4(_mm_loadu_ps((const float*)(i + n * 4)));
+        __m128i b = floatToHalf4(_mm_loadu_ps((const float*)(i + n * 4 + 16)));
+        _mm_storeu_si128((__m128i*)(o + n * 2), _mm_packs_epi32(a, b));
+    }
+#endif
+
+    const HalfTables& t = halfTables();
+
+    for (; n < num; n++)
+    {
+        uint32 bits;
+        memcpy(&bits, i + n * 4, 4);
+        uint16 h = floatBits(t, bits);
+        memcpy(o + n * 2, &h, 2);
+    }
+}
+
+//----------------------------------------------------------------------
+//
+//  Type conversion
+//
+
+struct HalfBits { uint16 bits; };
+
+template <typename D>
+inline D
+clampReal(double d)
+{
+    if (d != d) return D(0);
+    if (d <= double(std::numeric_limits<D>::min())) return std::numeric_limits<D>::min();
+    if (d >= double(std::numeric_limits<D>::max())) return std::numeric_limits<D>::max();
+    return D(d);
+}
+
+template <typename D, typename S>
+inline D
+clampInt(S s)
+{
+    if (s < S(std::numeric_limits<D>::min())) return std::numeric_limits<D>::min();
+    if (s > S(std::numeric_limits<D>::max())) return std::numeric_limits<D>::max();
+    return D(s);
+}
+
+//
+//  Widening and conversions between reals are plain casts. Anything
+//  narrowing to an integer type is clamped.
+//
+
+template <typename D, typename S>
+struct Converter
+{
+    static D convert(S s) { return D(s); }
+};
+
+#define GTO_CLAMP_REAL(D, S) \
+    template <> struct Converter<D, S> \
+    { static D convert(S s) { return clampReal<D>(s); } };
+
+#define GTO_CLAMP_INT(D, S) \
+    template <> struct Converter<D, S> \
+    { static D convert(S s) { return clampInt<D>(s); } };
+
+GTO_CLAMP_REAL(int32, float32)
+GTO_CLAMP_REAL(int32, float64)
+GTO_CLAMP_REAL(uint16, float32)
+GTO_CLAMP_REAL(uint16, float64)
+GTO_CLAMP_REAL(uint8, float32)
+GTO_CLAMP_REAL(uint8, float64)
+GTO_CLAMP_INT(uint16, int32)
+GTO_CLAMP_INT(uint8, int32)
+GTO_CLAMP_INT(uint8, uint16)
+
+#undef GTO_CLAMP_REAL
+#undef GTO_CLAMP_INT
+
+template <typename D>
+struct Converter<D, HalfBits>
+{
+    static D convert(HalfBits h) 
+    { 
+        return Converter<D, float32>::convert(halfToFloat(h.bits)); 
+    }
+};
+
+template <typename S>
+struct Converter<HalfBits, S>
+{
+    static HalfBits convert(S s) 
+    { 
+        HalfBits h;
+        h.bits = floatToHalf(Converter<float32, S>::convert(s));
+        return h;
+    }
+};
+
+template <>
+struct Converter<HalfBits, HalfBits>
+{
+    static HalfBits convert(HalfBits h) { return h; }
+};
+
+//
+//  The input and output may not be aligned (mapped files, the caller's
+//  buffers) so the values are moved with memcpy, which the compiler
+//  turns into plain loads and stores.
+//
+
+template <typename S, typename D>
+static void
+convertArray(const char* in, char* out, size_t num)
+{
+    for (size_t i = 0; i < num; i++)
+    {
+        S s;
+        memcpy(&s, in + i * sizeof(S), sizeof(S));
+        D d = Converter<D, S>::convert(s);
+        memcpy(out + i * sizeof(D), &d, sizeof(D));
+    }
+}
+
+template <typename S>
+static void
+convertFrom(const char* in, char* out, uint32 to, size_t num)
+{
+    switch (to)
+    {
+      case Int:    convertArray<S, int32>(in, out, num); break;
+      case Float:  convertArray<S, float32>(in, out, num); break;
+      case Double: convertArray<S, float64>(in, out, num); break;
+      case Half:   convertArray<S, HalfBits>(in, out, num); break;
+      case Short:  convertArray<S, uint16>(in, out, num); break;
+      case Byte:   convertArray<S, uint8>(in, out, num); break;
+    }
+}
+
+static void
+convertValues(const char* in, uint32 from, char* out, uint32 to, size_t num)
+{
+    if (from == Half && to == Float)
+    {
+        halfToFloat(in, out, num);
+        return;
+    }
+    else if (from == Float && to == Half)
+    {
+        floatToHalf(in, out, num);
+        return;
+    }
+
+    switch (from)
+    {
+      case Int:    convertFrom<int32>(in, out, to, num); break;
+      case Float:  convertFrom<float32>(in, out, to, num); break;
+      case Double: convertFrom<float64>(in, out, to, num); break;
+      case Half:   convertFrom<HalfBits>(in, out, to, num); break;
+      case Short:  convertFrom<uint16>(in, out, to, num); break;
+      case Byte:   convertFrom<uint8>(in, out, to, num); break;
+    }
+}
+
+bool
+canConvert(uint32 from, uint32 to)
+{
+    return from != String && from != Boolean && from < NumberOfDataTypes &&
+           to != String && to != Boolean && to < NumberOfDataTypes;
+}
+
+void
+convertData(const void* in, uint32 from, 
+            void* out, uint32 to,
+            size_t num, bool swapped)
+{
+    const char*  i        = (const char*)in;
+    char*        o        = (char*)out;
+    const size_t inSize   = dataSizeInBytes(from);
+    const size_t outSize  = dataSizeInBytes(to);
+
+    if (!swapped || inSize < 2)
+    {
+        convertValues(i, from, o, to, num);
+        return;
+    }
+
+    //
+    //  Swapped values are swapped into a small buffer which stays in
+    //  cache and converted from there
+    //
+
+    uint64 temp[512];
+    const size_t perPiece = sizeof(temp) / inSize;
+
+    for (size_t n = 0; n < num; n += perPiece)
+    {
+        size_t count = std::min(num - n, perPiece);
+        swapCopy(i + n * inSize, temp, count, from);
+        convertValues((const char*)temp, from, o + n * outSize, to, count);
+    }
+}
+
 } // Gto
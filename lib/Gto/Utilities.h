@@ -99,6 +99,66 @@ Number asNumber(void*, Gto::DataType);
 bool isGTOFile(const char*);
 void splitComponentName(const char* name, std::vector<std::string>& buffer);
 
+//
+//  Property filters (see Header.h). The functions process the data in
+//  GTO_FILTER_BLOCK byte pieces. filtersForType() returns the filters
+//  which can be applied to a type.
+//
+
+Gto::uint32 filtersForType(Gto::uint32);
+void shuffleBytes(void* data, size_t bytes, size_t wordSize);
+void unshuffleBytes(void* data, size_t bytes, size_t wordSize);
+void deltaEncode(void* data, size_t bytes, size_t wordSize);
+void deltaDecode(void* data, size_t bytes, size_t wordSize);
+
+//
+//  Byte swapping of num values of the given type. swapCopy() swaps
+//  them as it copies, in and out may be the same but may not
+//  otherwise overlap. Bytes and Booleans are left as is.
+//
+
+void swapData(void* data, size_t num, Gto::uint32 type);
+void swapCopy(const void* in, void* out, size_t num, Gto::uint32 type);
+
+//
+//  Transposed components store one record per element holding that
+//  element of each property. packField() copies count elements of
+//  fieldBytes each into the records, fieldOffset bytes into each
+//  record of recordBytes. unpackField() copies them back out.
+//
+
+void packField(const void* data, size_t fieldBytes, 
+               void* records, size_t recordBytes, size_t fieldOffset,
+               size_t count);
+void unpackField(const void* records, size_t recordBytes, size_t fieldOffset,
+                 void* data, size_t fieldBytes,
+                 size_t count);
+
+//
+//  Half floats (IEEE 754 binary16, Gto::Half). Conversion rounds to
+//  the nearest half; floats too large for a half become infinity. The
+//  array versions convert num values, in and out may not overlap and
+//  need not be aligned.
+//
+
+float32 halfToFloat(uint16);
+uint16 floatToHalf(float32);
+void halfToFloat(const void* in, void* out, size_t num);
+void floatToHalf(const void* in, void* out, size_t num);
+
+//
+//  Type conversion of property data. Any of the number types (Int,
+//  Float, Double, Half, Short and Byte) can be converted to any other.
+//  Values out of range of an integer type are clamped. If swapped the
+//  input is byte swapped as it's converted. in and out may not
+//  overlap.
+//
+
+bool canConvert(Gto::uint32 from, Gto::uint32 to);
+void convertData(const void* in, Gto::uint32 from, 
+                 void* out, Gto::uint32 to,
+                 size_t num, bool swapped = false);
+
 
 } // Gto
 
@@ -40,6 +40,10 @@
 
 #include "Writer.h"
 #include "Utilities.h"
+#include "BlockIO.h"
+#include "Codec.h"
+#include "ThreadPool.h"
+#include <algorithm>
 #include <fstream>
 #include <ctype.h>
 #include <stdio.h>
@@ -48,10 +52,6 @@
 
 #define GTO_DEBUG 0
 
-#ifdef GTO_SUPPORT_ZIP
-#include <zlib.h>
-#endif
-
 #ifdef WIN32
 #define snprintf _snprintf
 #endif
@@ -59,19 +59,70 @@
 namespace Gto {
 using namespace std;
 
+//
+//  Data waiting to be written by the write-behind thread. Small
+//  writes are gathered into copy; borrowed data is written from the
+//  caller's memory.
+//
+
+struct WriteJob : public ThreadPool::Job
+{
+    WriteJob(Writer* w, 
+             const void* p, 
+             size_t s, 
+             Writer::DataWrittenFunc f, 
+             void* u)
+        : writer(w), data(p), size(s), done(f), userData(u) {}
+
+    virtual void run()
+    {
+        writer->writeNow(data, size);
+        if (done) done(data, userData);
+    }
+
+    Writer*                 writer;
+    const void*             data;
+    size_t                  size;
+    std::vector<char>       copy;
+    Writer::DataWrittenFunc done;
+    void*                   userData;
+};
+
+//
+//  Small writes are handed to the write-behind thread in pieces of
+//  about this size
+//
+
+static const size_t WriteBehindChunkSize = 1024 * 1024;
+
 
 Writer::Writer() 
     : m_out(0), 
       m_gzfile(0),
+      m_blocks(0),
+      m_blockSize(BlockWriter::DefaultBlockSize),
+      m_numThreads(1),
+      m_writeThread(0),
+      m_queuedBytes(0),
+      m_maxQueuedBytes(DefaultMaxQueuedBytes),
+      m_filters(NoFilter),
+      m_appendBytes(0),
       m_needsClosing(false), 
       m_error(false),
       m_tableFinished(false),
       m_currentProperty(0),
       m_type(CompressedGTO),
+      m_bytesWritten(0),
       m_endDataCalled(false),
       m_beginDataCalled(false),
       m_objectActive(false),
-      m_componentActive(false)
+      m_componentActive(false),
+      m_streaming(false),
+      m_footerPending(false),
+      m_writeBehind(false),
+      m_appending(false),
+      m_appendOk(false),
+      m_floatsAsHalf(false)
 {
     init(0);
 }
@@ -79,15 +130,30 @@ Writer::Writer()
 Writer::Writer(ostream &o) 
     : m_out(0), 
       m_gzfile(0),
+      m_blocks(0),
+      m_blockSize(BlockWriter::DefaultBlockSize),
+      m_numThreads(1),
+      m_writeThread(0),
+      m_queuedBytes(0),
+      m_maxQueuedBytes(DefaultMaxQueuedBytes),
+      m_filters(NoFilter),
+      m_appendBytes(0),
       m_needsClosing(false), 
       m_error(false), 
       m_tableFinished(false),
       m_currentProperty(0),
       m_type(CompressedGTO),
+      m_bytesWritten(0),
       m_endDataCalled(false),
       m_beginDataCalled(false),
       m_objectActive(false),
-      m_componentActive(false)
+      m_componentActive(false),
+      m_streaming(false),
+      m_footerPending(false),
+      m_writeBehind(false),
+      m_appending(false),
+      m_appendOk(false),
+      m_floatsAsHalf(false)
 {
     init(&o);
 }
@@ -118,20 +184,25 @@ Writer::open(const char* filename, FileType type)
     m_needsClosing = false;
 
     if (m_outName != "" && (m_out || m_gzfile)) return false;
+    if (m_streaming && type == TextGTO) return false;
 
-#ifndef GTO_SUPPORT_ZIP
-    if (type == CompressedGTO) type = BinaryGTO;
-#endif
+    if (type == CompressedGTO && !CompressedFile::supported()) type = BinaryGTO;
+
+    //
+    //  Parallel gzip goes through an ostream like the block files
+    //
+
+    bool parallelGzip = type == CompressedGTO && m_numThreads != 1;
 
-    if (!m_out && (type == BinaryGTO || type == TextGTO))
+    if (!m_out && (type != CompressedGTO || parallelGzip))
     {
-        if (type == BinaryGTO)
+        if (type == TextGTO)
         {
-            m_out = new ofstream(filename, ios::out|ios::binary);
+            m_out = new ofstream(filename, ios::out);
         }
         else
         {
-            m_out = new ofstream(filename, ios::out);
+            m_out = new ofstream(filename, ios::out|ios::binary);
         }
 
         m_needsClosing = true;
@@ -143,29 +214,90 @@ Writer::open(const char* filename, FileType type)
             return false;
         }
     }
-#ifdef GTO_SUPPORT_ZIP
-    else if (type == CompressedGTO)
+    else if (type == CompressedGTO && !parallelGzip)
     {
-        m_gzfile = gzopen(filename, "wb");
+        m_gzfile = new CompressedFile;
         m_needsClosing = true;
 
-        if (!m_gzfile)
+        if (!m_gzfile->open(filename, "wb"))
         {
+            delete m_gzfile;
             m_gzfile = 0;
             m_error  = true;
             return false;
         }
     }
-#endif
 
-    m_error = false;
+    switch (type)
+    {
+      case CompressedGTO:
+          if (parallelGzip)
+          {
+              m_blocks = new GzipWriter(*m_out, m_numThreads, m_blockSize);
+          }
+          break;
+      case BlockCompressedGTO:
+          m_blocks = new BlockWriter(*m_out, ZlibCodec, 
+                                     m_blockSize, m_numThreads);
+          break;
+      case LZ4CompressedGTO:
+          m_blocks = new BlockWriter(*m_out, Lz4Codec, 
+                                     m_blockSize, m_numThreads);
+          break;
+      case ZstdCompressedGTO:
+          m_blocks = new BlockWriter(*m_out, ZstdCodec, 
+                                     m_blockSize, m_numThreads);
+          break;
+      default:
+          break;
+    }
+
+    m_error        = false;
+    m_bytesWritten = 0;
+    m_queuedBytes  = 0;
+
+    if (m_writeBehind && type != TextGTO) m_writeThread = new ThreadPool(1);
+
+    if (m_streaming)
+    {
+        //
+        //  The real header goes at the end of the file
+        //
+
+        Header header;
+        header.magic      = GTO_MAGIC;
+        header.numObjects = 0;
+        header.numStrings = 0;
+        header.version    = GTO_VERSION;
+        header.flags      = HeaderAtEnd;
+
+        write(&header, sizeof(Header));
+        m_footerPending = true;
+    }
+
     return true;
 }
 
 void
 Writer::close()
 {
-    if (m_beginDataCalled && !m_endDataCalled) 
+    if (m_appending)
+    {
+        cerr << "WARNING: Gto::Writer::close() -- you forgot to call "
+             << "endPropertyData(), the rest of the property is zeros" << endl;
+
+        vector<char> zeros(GTO_FILTER_BLOCK);
+
+        while (m_appendBytes)
+        {
+            size_t n = size_t(std::min(m_appendBytes, uint64(zeros.size())));
+            appendPropertyDataRaw(&zeros.front(), n);
+        }
+
+        endPropertyData();
+    }
+
+    if (m_beginDataCalled && !m_endDataCalled && !m_streaming) 
     {
         //
         //  Should this be an error? We can gracefully finish like
@@ -178,22 +310,27 @@ Writer::close()
         endData();
     }
 
+    finishTransposed(true);
+    if (m_footerPending) writeFooter();
+    finishWrites();
+
+    if (m_blocks)
+    {
+        m_blocks->finish();
+        delete m_blocks;
+        m_blocks = 0;
+    }
+
     if (m_out && m_needsClosing)
     {
         delete m_out;
     }
-#ifdef GTO_SUPPORT_ZIP
     else if (m_gzfile && m_needsClosing)
     {
-        #if ZLIB_VERNUM >= UPDATED_ZLIB_VERNUM
-            gzclose((gzFile_s*)m_gzfile);
-        #else
-            gzclose(m_gzfile);
-        #endif
+        delete m_gzfile;
     }
 
     m_gzfile = 0;
-#endif
     m_out    = 0;
 }
 
@@ -207,6 +344,22 @@ Writer::beginData()
 void
 Writer::beginData(const std::string *orderedStrings, size_t num)
 {
+    if (m_streaming)
+    {
+        //
+        //  The string table and header are written by close()
+        //
+
+        if (num > 0)
+        {
+            throw std::runtime_error("Gto::Writer::beginData(): ordered "
+                                     "strings can't be used when streaming");
+        }
+
+        m_beginDataCalled = true;
+        return;
+    }
+
     m_currentProperty = 0;
     constructStringTable(orderedStrings, num);
 
@@ -256,7 +409,23 @@ Writer::intern(const char* s)
                                  "strings after string table is finished");
     }
 
-    m_strings[s] = -1;
+    if (m_streaming)
+    {
+        //
+        //  Ids are handed out as strings are interned so they can be
+        //  used in data which is written before the table.
+        //
+
+        if (m_strings.find(s) == m_strings.end())
+        {
+            int id = m_strings.size();
+            m_strings[s] = id;
+        }
+    }
+    else
+    {
+        m_strings[s] = -1;
+    }
 }
 
 void
@@ -268,13 +437,29 @@ Writer::intern(const string& s)
                                  "strings after string table is finished");
     }
 
-    m_strings[s] = -1;
+    if (m_streaming)
+    {
+        //
+        //  Ids are handed out as strings are interned so they can be
+        //  used in data which is written before the table.
+        //
+
+        if (m_strings.find(s) == m_strings.end())
+        {
+            int id = m_strings.size();
+            m_strings[s] = id;
+        }
+    }
+    else
+    {
+        m_strings[s] = -1;
+    }
 }
 
 uint32
 Writer::lookup(const char* s) const
 {
-    if (m_tableFinished)
+    if (m_tableFinished || m_streaming)
     {
         StringMap::const_iterator i = m_strings.find(s);
 
@@ -296,7 +481,7 @@ Writer::lookup(const char* s) const
 uint32
 Writer::lookup(const string& s) const
 {
-    if (m_tableFinished)
+    if (m_tableFinished || m_streaming)
     {
         StringMap::const_iterator i = m_strings.find(s);
 
@@ -400,6 +585,7 @@ Writer::beginComponent(const char* name,
         header.interpretation = m_names.size() - 1;
 
         m_components.push_back(header);
+        m_componentProperties.push_back(m_properties.size());
         m_componentActive = true;
     }
 }
@@ -409,6 +595,7 @@ Writer::endComponent()
 {
     m_componentActive = false;
     m_componentScope.pop_back();
+    if (m_streaming) finishTransposed();
 }
 
 void
@@ -430,13 +617,26 @@ Writer::property(const char* name,
                                  "no active component or object");
     }
 
+    const ComponentHeader& comp  = m_components.back();
+    const size_t           first = m_componentProperties.back();
+
+    if ((comp.flags & Transposed) && comp.numProperties &&
+        numElements != m_properties[first].size)
+    {
+        throw std::runtime_error("ERROR: Gto::Writer::property() -- the "
+                                 "properties of a transposed component must "
+                                 "have the same number of elements");
+    }
+
     m_names.push_back(name);
     m_components.back().numProperties++;
 
+    const bool asHalf = m_floatsAsHalf && type == Float && m_type != TextGTO;
+
     PropertyHeader header;
     memset(&header, 0, sizeof(PropertyHeader));
     header.size = numElements;
-    header.type = type;
+    header.type = asHalf ? Half : type;
     header.name = m_names.size() - 1;
     header.dims = dims;
 
@@ -445,6 +645,11 @@ Writer::property(const char* name,
     header.interpretation = m_names.size() - 1;
 
     m_properties.push_back(header);
+    m_propertyComponent.push_back(m_components.size() - 1);
+    m_propertyFilters.push_back(m_type == TextGTO || (comp.flags & Transposed)
+                                ? NoFilter
+                                : m_filters & filtersForType(header.type));
+    m_propertyAsHalf.push_back(asHalf);
 
     if (m_type == TextGTO)
     {
@@ -651,20 +856,18 @@ Writer::writeQuotedString(const string& str)
 void
 Writer::writeText(const std::string& s)
 {
-    if (m_out)
+    if (m_blocks)
+    {
+        m_blocks->write(s.c_str(), s.size());
+    }
+    else if (m_out)
     {
         (*m_out) << s;
     }
-#ifdef GTO_SUPPORT_ZIP
     else if (m_gzfile)
     {
-        #if ZLIB_VERNUM >= UPDATED_ZLIB_VERNUM
-            gzwrite((gzFile_s*)m_gzfile, (void*)s.c_str(), s.size());
-        #else
-            gzwrite(m_gzfile, (void*)s.c_str(), s.size());
-        #endif
+        m_gzfile->write(s.c_str(), s.size());
     }
-#endif
 }
 
 void
@@ -689,49 +892,154 @@ Writer::writeFormatted(const char* format, ...)
 }
 
 void
-Writer::write(const void* p, size_t s)
+Writer::write(const void* p, size_t s, DataWrittenFunc done, void* userData)
+{
+    if (s == 0)
+    {
+        if (done) done(p, userData);
+        return;
+    }
+
+    m_bytesWritten += s;
+
+    if (m_writeThread)
+    {
+        queueWrite(p, s, done, userData);
+    }
+    else
+    {
+        writeNow(p, s);
+        if (done) done(p, userData);
+    }
+}
+
+void
+Writer::writeNow(const void* p, size_t s)
 {
-    if( s == 0 ) return;
-    if (m_out)
+    if (m_blocks)
+    {
+        m_blocks->write(p, s);
+    }
+    else if (m_out)
     {
         m_out->write((const char*)p, s);
     }
-#ifdef GTO_SUPPORT_ZIP
     else if (m_gzfile)
     {
-        #if ZLIB_VERNUM >= UPDATED_ZLIB_VERNUM
-            gzwrite((gzFile_s*)m_gzfile, (void*)p, s);
-        #else
-            gzwrite(m_gzfile, (void*)p, s);
-        #endif
+        m_gzfile->write(p, s);
     }
-#endif
 }
 
 void
 Writer::write(const std::string& s)
 {
-    if (m_out)
+    if (m_writeThread)
+    {
+        write(s.c_str(), s.size() + 1);
+        return;
+    }
+
+    m_bytesWritten += s.size() + 1;
+
+    if (m_blocks)
+    {
+        m_blocks->write(s.c_str(), s.size() + 1);
+    }
+    else if (m_out)
     {
         (*m_out) << s;
         m_out->put(0);
     }
-#ifdef GTO_SUPPORT_ZIP
     else if (m_gzfile)
     {
-        #if ZLIB_VERNUM >= UPDATED_ZLIB_VERNUM
-            gzwrite((gzFile_s*)m_gzfile, (void*)s.c_str(), s.size() + 1);
-        #else
-            gzwrite(m_gzfile, (void*)s.c_str(), s.size() + 1);
-        #endif
+        m_gzfile->write(s.c_str(), s.size() + 1);
     }
-#endif
 }
 
 void
 Writer::flush()
 {
-    if (m_out) (*m_out) << std::flush;
+    if (m_writeThread)
+    {
+        submitPendingWrites();
+    }
+    else if (m_out) 
+    {
+        (*m_out) << std::flush;
+    }
+}
+
+void
+Writer::queueWrite(const void* p, size_t s, DataWrittenFunc done, void* userData)
+{
+    if (!done)
+    {
+        const char* c = (const char*)p;
+        m_pendingWrites.insert(m_pendingWrites.end(), c, c + s);
+
+        if (m_pendingWrites.size() >= WriteBehindChunkSize) 
+        {
+            submitPendingWrites();
+        }
+    }
+    else
+    {
+        submitPendingWrites();
+        addWriteJob(new WriteJob(this, p, s, done, userData));
+    }
+}
+
+void
+Writer::submitPendingWrites()
+{
+    if (m_pendingWrites.empty()) return;
+
+    WriteJob* job = new WriteJob(this, 0, 0, 0, 0);
+    job->copy.swap(m_pendingWrites);
+    job->data = &job->copy.front();
+    job->size = job->copy.size();
+    addWriteJob(job);
+}
+
+void
+Writer::addWriteJob(WriteJob* job)
+{
+    m_writeThread->add(job);
+    m_writeJobs.push_back(job);
+    m_queuedBytes += job->size;
+
+    //
+    //  Block until there's room in the queue
+    //
+
+    while (m_queuedBytes > m_maxQueuedBytes && !m_writeJobs.empty())
+    {
+        WriteJob* oldest = m_writeJobs.front();
+        m_writeJobs.pop_front();
+        m_writeThread->wait(oldest);
+        m_queuedBytes -= oldest->size;
+        delete oldest;
+    }
+}
+
+void
+Writer::finishWrites()
+{
+    if (!m_writeThread) return;
+
+    submitPendingWrites();
+
+    while (!m_writeJobs.empty())
+    {
+        WriteJob* job = m_writeJobs.front();
+        m_writeJobs.pop_front();
+        m_writeThread->wait(job);
+        delete job;
+    }
+
+    delete m_writeThread;
+    m_writeThread = 0;
+    m_queuedBytes = 0;
 }
 
 void
@@ -767,13 +1075,57 @@ Writer::writeHead()
 
     for (size_t i=0; i < m_properties.size(); i++)
     {
-        PropertyHeader &p = m_properties[i];
+        PropertyHeader p = m_properties[i];
+        p.type |= m_propertyFilters[i] << GTO_FILTER_SHIFT;
         write(&p, sizeof(PropertyHeader));
     }
 
     flush();
 }
 
+void
+Writer::writeFooter()
+{
+    m_footerPending = false;
+
+    if (m_currentProperty < m_properties.size())
+    {
+        //
+        //  The header has to describe the data in the file, so the
+        //  missing properties are filled with zeros.
+        //
+
+        cerr << "WARNING: Gto::Writer::close() -- "
+             << m_properties.size() - m_currentProperty
+             << " properties were declared but not written" << endl;
+
+        vector<char> zeros(GTO_FILTER_BLOCK);
+
+        for (; m_currentProperty < m_properties.size(); m_currentProperty++)
+        {
+            const PropertyHeader& info = m_properties[m_currentProperty];
+            uint64 bytes = uint64(info.size) * elementSize(info.dims) *
+                           dataSizeInBytes(info.type);
+
+            while (bytes)
+            {
+                size_t n = size_t(std::min(bytes, uint64(zeros.size())));
+                write(&zeros.front(), n);
+                bytes -= n;
+            }
+        }
+    }
+
+    Footer footer;
+    footer.headerOffset = m_bytesWritten;
+    footer.flags        = 0;
+    footer.magic        = GTO_MAGIC;
+
+    constructStringTable(0, 0);
+    writeHead();
+    write(&footer, sizeof(Footer));
+}
+
 bool
 Writer::propertySanityCheck(const char *propertyName, 
                             uint32 size, 
@@ -834,16 +1186,37 @@ Writer::propertyDataRaw(const void* data,
                         uint32 size, 
                         const Dimensions& dims)
 {
-    if (!m_beginDataCalled) beginData();
+    writeProperty(data, propertyName, size, dims, 0, 0);
+}
 
-    size_t                p     = m_currentProperty++;
+void 
+Writer::propertyDataBorrowed(const void* data,
+                             DataWrittenFunc done,
+                             void* userData,
+                             const char *propertyName, 
+                             uint32 size, 
+                             const Dimensions& dims)
+{
+    writeProperty(data, propertyName, size, dims, done, userData);
+}
+
+void 
+Writer::writeProperty(const void* data,
+                      const char *propertyName, 
+                      uint32 size, 
+                      const Dimensions& dims,
+                      DataWrittenFunc done,
+                      void* userData)
+{
+    bool                  ok    = nextProperty(propertyName, size, dims);
+    size_t                p     = m_currentProperty - 1;
     const PropertyHeader& info  = m_properties[p];
     size_t                esize = elementSize(info.dims);
     size_t                n     = info.size * esize;
     size_t                ds    = dataSizeInBytes(info.type);
     char*                 bdata = (char*)data;
 
-    if (propertySanityCheck(propertyName, size, dims))
+    if (ok)
     {
         if (m_type == TextGTO)
         {
@@ -1041,14 +1414,438 @@ Writer::propertyDataRaw(const void* data,
 
             writeText("\n");
         }
+        else if (m_propertyFilters[p] || isTransposed(p) || m_propertyAsHalf[p])
+        {
+            writePropertyPiece(data, dataSize(p) * n);
+            finishPropertyPieces();
+        }
         else
         {
             size_t bytes = dataSizeInBytes(m_properties[p].type) * n;
-            write(data, bytes);
+            write(data, bytes, done, userData);
+            return;
         }
     }
+
+    if (done) done(data, userData);
+}
+
+bool
+Writer::nextProperty(const char* propertyName, 
+                     uint32 size, 
+                     const Dimensions& dims)
+{
+    if (!m_beginDataCalled) beginData();
+
+    if (m_appending)
+    {
+        throw std::runtime_error("ERROR: Gto::Writer::propertyData() -- "
+                                 "endPropertyData() was not called");
+    }
+
+    if (m_currentProperty >= m_properties.size())
+    {
+        throw std::runtime_error("ERROR: Gto::Writer::propertyData() -- "
+                                 "no property declared for the data");
+    }
+
+    m_currentProperty++;
+    return propertySanityCheck(propertyName, size, dims);
 }
 
+//
+//  The size of a value of property p as it's passed to the Writer and
+//  the size of all of them. Floats stored as halfs are passed as
+//  floats.
+//
+
+size_t
+Writer::dataSize(size_t p) const
+{
+    return m_propertyAsHalf[p] ? sizeof(float32) 
+                               : dataSizeInBytes(m_properties[p].type);
+}
+
+uint64
+Writer::propertyBytes(size_t p) const
+{
+    const PropertyHeader& info = m_properties[p];
+    return uint64(info.size) * elementSize(info.dims) * dataSize(p);
+}
+
+void
+Writer::writePropertyPiece(const void* data, size_t bytes)
+{
+    if (!m_propertyAsHalf[m_currentProperty - 1])
+    {
+        writeStoredPiece(data, bytes);
+        return;
+    }
+
+    if (bytes % sizeof(float32))
+    {
+        throw std::runtime_error("ERROR: Gto::Writer -- the data of a float "
+                                 "property stored as half must be passed as "
+                                 "whole floats");
+    }
+
+    //
+    //  Converted a block at a time
+    //
+
+    const char*  p        = (const char*)data;
+    const size_t num      = bytes / sizeof(float32);
+    const size_t perBlock = GTO_FILTER_BLOCK / sizeof(uint16);
+    m_halfBuffer.resize(std::min(num, perBlock) * sizeof(uint16));
+
+    for (size_t i = 0; i < num; i += perBlock)
+    {
+        size_t n = std::min(num - i, perBlock);
+        floatToHalf(p + i * sizeof(float32), &m_halfBuffer.front(), n);
+        writeStoredPiece(&m_halfBuffer.front(), n * sizeof(uint16));
+    }
+}
+
+void
+Writer::writeStoredPiece(const void* data, size_t bytes)
+{
+    uint32 filters = m_propertyFilters[m_currentProperty - 1];
+
+    if (isTransposed(m_currentProperty - 1))
+    {
+        stageTransposed(data, bytes);
+        return;
+    }
+    else if (!filters)
+    {
+        write(data, bytes);
+        return;
+    }
+
+    //
+    //  Filtered data is gathered into blocks. The blocks are the same
+    //  ones the Reader will decode.
+    //
+
+    const char* p = (const char*)data;
+    m_filterBuffer.reserve(GTO_FILTER_BLOCK);
+
+    while (bytes)
+    {
+        size_t n = std::min(bytes, GTO_FILTER_BLOCK - m_filterBuffer.size());
+        m_filterBuffer.insert(m_filterBuffer.end(), p, p + n);
+        p     += n;
+        bytes -= n;
+
+        if (m_filterBuffer.size() == GTO_FILTER_BLOCK) writeFilterBlock();
+    }
+}
+
+void
+Writer::finishPropertyPieces()
+{
+    if (!m_filterBuffer.empty()) writeFilterBlock();
+    if (isTransposed(m_currentProperty - 1)) finishTransposed();
+}
+
+bool
+Writer::isTransposed(size_t p) const
+{
+    return m_type != TextGTO && p < m_properties.size() &&
+           (m_components[m_propertyComponent[p]].flags & Transposed);
+}
+
+void
+Writer::stageTransposed(const void* data, size_t bytes)
+{
+    size_t p     = m_currentProperty - 1;
+    size_t field = p - m_componentProperties[m_propertyComponent[p]];
+    
+    if (field == 0 && m_transposeBuffers.size() > 1) m_transposeBuffers.clear();
+    if (m_transposeBuffers.size() <= field) m_transposeBuffers.resize(field + 1);
+
+    const char* d = (const char*)data;
+    m_transposeBuffers[field].insert(m_transposeBuffers[field].end(), d, d + bytes);
+}
+
+void
+Writer::finishTransposed(bool closing)
+{
+    //
+    //  The records are written once every property of the component
+    //  has its data (and when streaming no more can be declared)
+    //
+
+    if (m_transposeBuffers.empty() || m_appending) return;
+
+    const size_t           c     = m_propertyComponent[m_currentProperty - 1];
+    const ComponentHeader& comp  = m_components[c];
+    const size_t           first = m_componentProperties[c];
+
+    if (m_currentProperty != first + comp.numProperties) return;
+
+    if (m_streaming && !closing && m_componentActive && 
+        c == m_components.size() - 1)
+    {
+        return;
+    }
+
+    vector<size_t> fieldBytes(comp.numProperties);
+    size_t         recordBytes = 0;
+
+    for (size_t i = 0; i < comp.numProperties; i++)
+    {
+        fieldBytes[i] = elementSize(m_properties[first + i].dims) *
+                        dataSizeInBytes(m_properties[first + i].type);
+        recordBytes  += fieldBytes[i];
+    }
+
+    //
+    //  Records are put together a block at a time so the pieces of each
+    //  property being read stay in cache
+    //
+
+    const size_t count    = m_properties[first].size;
+    const size_t perBlock = std::max(size_t(1), GTO_FILTER_BLOCK / std::max(recordBytes, size_t(1)));
+    vector<char> block(std::min(count, perBlock) * recordBytes);
+
+    for (size_t r = 0; r < count && recordBytes; r += perBlock)
+    {
+        size_t n = std::min(count - r, perBlock);
+
+        for (size_t i = 0, offset = 0; i < comp.numProperties; offset += fieldBytes[i++])
+        {
+            if (!fieldBytes[i]) continue;
+            packField(&m_transposeBuffers[i][r * fieldBytes[i]], fieldBytes[i], 
+                      &block.front(), recordBytes, offset, n);
+        }
+
+        write(&block.front(), n * recordBytes);
+    }
+
+    m_transposeBuffers.clear();
+}
+
+void
+Writer::writeFilterBlock()
+{
+    const PropertyHeader& info = m_properties[m_currentProperty - 1];
+    uint32 filters  = m_propertyFilters[m_currentProperty - 1];
+    size_t wordSize = dataSizeInBytes(info.type);
+    char*  block    = &m_filterBuffer.front();
+    size_t n        = m_filterBuffer.size();
+
+    if (filters & DeltaFilter)   deltaEncode(block, n, wordSize);
+    if (filters & ShuffleFilter) shuffleBytes(block, n, wordSize);
+
+    write(block, n);
+    m_filterBuffer.clear();
+}
+
+void
+Writer::propertyDataSpans(const DataSpan* spans, 
+                          size_t numSpans,
+                          const char *propertyName, 
+                          uint32 size, 
+                          const Dimensions& dims)
+{
+    uint64 total = 0;
+    for (size_t i = 0; i < numSpans; i++) total += spans[i].bytes;
+
+    if (m_type == TextGTO)
+    {
+        vector<char> data;
+        data.reserve(total);
+
+        for (size_t i = 0; i < numSpans; i++)
+        {
+            const char* p = (const char*)spans[i].data;
+            data.insert(data.end(), p, p + spans[i].bytes);
+        }
+
+        propertyDataRaw(data.empty() ? 0 : &data.front(), 
+                        propertyName, size, dims);
+        return;
+    }
+
+    bool ok = nextProperty(propertyName, size, dims);
+
+    if (total != propertyBytes(m_currentProperty - 1))
+    {
+        throw std::runtime_error("ERROR: Gto::Writer::propertyDataSpans() "
+                                 "-- the spans are not the size of the "
+                                 "property");
+    }
+
+    if (!ok) return;
+
+    for (size_t i = 0; i < numSpans; i++)
+    {
+        writePropertyPiece(spans[i].data, spans[i].bytes);
+    }
+
+    finishPropertyPieces();
+}
+
+void
+Writer::propertyDataStrided(const void* data,
+                            size_t stride,
+                            const char *propertyName, 
+                            uint32 size, 
+                            const Dimensions& dims)
+{
+    if (m_currentProperty >= m_properties.size())
+    {
+        propertyDataRaw(data, propertyName, size, dims);
+        return;
+    }
+
+    const PropertyHeader& info = m_properties[m_currentProperty];
+    size_t elementBytes = elementSize(info.dims) * dataSize(m_currentProperty);
+    size_t count        = info.size;
+    const char* in      = (const char*)data;
+
+    if (stride == elementBytes || count == 0)
+    {
+        propertyDataRaw(data, propertyName, size, dims);
+        return;
+    }
+
+    if (m_type == TextGTO)
+    {
+        vector<char> packed(count * elementBytes);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            memcpy(&packed[i * elementBytes], in + i * stride, elementBytes);
+        }
+
+        propertyDataRaw(&packed.front(), propertyName, size, dims);
+        return;
+    }
+
+    if (!nextProperty(propertyName, size, dims)) return;
+
+    //
+    //  Gather the elements a block at a time
+    //
+
+    size_t perBlock = std::max(size_t(1), GTO_FILTER_BLOCK / elementBytes);
+    vector<char> packed(std::min(count, perBlock) * elementBytes);
+
+    for (size_t i = 0; i < count; i += perBlock)
+    {
+        size_t n   = std::min(count - i, perBlock);
+        char*  out = &packed.front();
+
+        for (size_t q = 0; q < n; q++, out += elementBytes)
+        {
+            memcpy(out, in + (i + q) * stride, elementBytes);
+        }
+
+        writePropertyPiece(&packed.front(), n * elementBytes);
+    }
+
+    finishPropertyPieces();
+}
+
+
+void
+Writer::beginPropertyData(const char *propertyName, 
+                          uint32 size, 
+                          const Dimensions& dims)
+{
+    if (m_type == TextGTO)
+    {
+        //
+        //  Text is formatted from the whole property at the end
+        //
+
+        if (!m_beginDataCalled) beginData();
+
+        if (m_currentProperty >= m_properties.size())
+        {
+            throw std::runtime_error("ERROR: Gto::Writer::beginPropertyData() "
+                                     "-- no property declared for the data");
+        }
+
+        m_currentProperty++;
+        m_appendOk = propertySanityCheck(propertyName, size, dims);
+        m_currentProperty--;
+
+        m_appendBuffer.clear();
+        m_appendBytes = propertyBytes(m_currentProperty);
+    }
+    else
+    {
+        m_appendOk    = nextProperty(propertyName, size, dims);
+        m_appendBytes = propertyBytes(m_currentProperty - 1);
+    }
+
+    m_appending = true;
+}
+
+void
+Writer::appendPropertyDataRaw(const void* data, size_t bytes)
+{
+    if (!m_appending)
+    {
+        throw std::runtime_error("ERROR: Gto::Writer::appendPropertyData() "
+                                 "-- beginPropertyData() was not called");
+    }
+
+    if (bytes > m_appendBytes)
+    {
+        throw std::runtime_error("ERROR: Gto::Writer::appendPropertyData() "
+                                 "-- more data than the property holds");
+    }
+
+    m_appendBytes -= bytes;
+    if (!m_appendOk) return;
+
+    if (m_type == TextGTO)
+    {
+        const char* p = (const char*)data;
+        m_appendBuffer.insert(m_appendBuffer.end(), p, p + bytes);
+    }
+    else
+    {
+        writePropertyPiece(data, bytes);
+    }
+}
+
+void
+Writer::endPropertyData()
+{
+    if (!m_appending)
+    {
+        throw std::runtime_error("ERROR: Gto::Writer::endPropertyData() "
+                                 "-- beginPropertyData() was not called");
+    }
+
+    if (m_appendBytes)
+    {
+        throw std::runtime_error("ERROR: Gto::Writer::endPropertyData() "
+                                 "-- less data than the property holds");
+    }
+
+    m_appending = false;
+
+    if (m_type == TextGTO && !m_appendOk)
+    {
+        m_currentProperty++;
+    }
+    else if (m_type == TextGTO)
+    {
+        vector<char> data;
+        data.swap(m_appendBuffer);
+        propertyDataRaw(data.empty() ? 0 : &data.front());
+    }
+    else if (m_appendOk)
+    {
+        finishPropertyPieces();
+    }
+}
 
 } // Gto
 
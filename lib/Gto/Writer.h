@@ -38,7 +38,9 @@
 #define __Gto__Writer__h__
 #include <Gto/Header.h>
 #include <Gto/Utilities.h>
+#include <algorithm>
 #include <assert.h>
+#include <deque>
 #include <iostream>
 #include <map>
 #include <string>
@@ -48,6 +50,11 @@
 
 namespace Gto {
 
+class ChunkWriter;
+class CompressedFile;
+class ThreadPool;
+struct WriteJob;
+
 //
 //  class Gto::Writer
 //
@@ -77,11 +84,45 @@ class Writer
     typedef std::vector<ObjectHeader>      Objects;
     typedef std::map<size_t, PropertyPath> PropertyMap;
 
+    //
+    //  Called when borrowed property data has been written (see
+    //  propertyDataBorrowed() below).
+    //
+
+    typedef void (*DataWrittenFunc)(const void* data, void* userData);
+
+    //
+    //  A piece of a property's data (see propertyDataSpans())
+    //
+
+    struct DataSpan
+    {
+        DataSpan(const void* d = 0, size_t b = 0) : data(d), bytes(b) {}
+        const void* data;
+        size_t      bytes;
+    };
+
+    //
+    //  BlockCompressedGTO files are compressed in independent blocks
+    //  with an index at the end of the file. Unlike CompressedGTO
+    //  files, a reader can seek to any property in the file without
+    //  decompressing everything in front of it. They cannot be read
+    //  by gunzip.
+    //
+    //  LZ4CompressedGTO and ZstdCompressedGTO are block compressed
+    //  files which use LZ4 or Zstandard instead of zlib. LZ4 files are
+    //  larger but decompress many times faster. If the library was
+    //  not built with the codec, zlib is used instead.
+    //
+
     enum FileType
     {
         BinaryGTO,
         CompressedGTO,
-        TextGTO
+        TextGTO,
+        BlockCompressedGTO,
+        LZ4CompressedGTO,
+        ZstdCompressedGTO
     };
 
     Writer();
@@ -101,6 +142,63 @@ class Writer
 
     bool open(const char* f, bool c) { return open(f, c ? CompressedGTO : BinaryGTO); }
 
+    //
+    //  Size of the uncompressed blocks in a BlockCompressedGTO
+    //  file. Smaller blocks make random access cheaper, larger ones
+    //  compress better. Also the size of the gzip members when a
+    //  CompressedGTO file is written by more than one thread. Call
+    //  before open().
+    //
+
+    void setBlockSize(size_t bytes) { m_blockSize = bytes; }
+    size_t blockSize() const { return m_blockSize; }
+
+    //
+    //  Number of threads used to compress CompressedGTO and the block
+    //  compressed file types. 0 uses one thread per processor. With
+    //  more than one thread a CompressedGTO file is written as a
+    //  series of independently deflated gzip members which any gzip
+    //  reader will concatenate. Call before open().
+    //
+
+    void setNumThreads(size_t n) { m_numThreads = n; }
+    size_t numThreads() const { return m_numThreads; }
+
+    //
+    //  In streaming mode property data can be written as soon as the
+    //  property is declared (beginData() is optional) and the header
+    //  is written at the end of the file by close(). Only the data of
+    //  the property being written needs to be in memory. Data must
+    //  still be written in declaration order. String ids returned by
+    //  lookup() are valid as soon as the string is interned. Text
+    //  files can't be streamed. Call before open().
+    //
+
+    void setStreaming(bool b) { m_streaming = b; }
+    bool streaming() const { return m_streaming; }
+
+    //
+    //  In write-behind mode the file is written by a background
+    //  thread. The data passed to propertyData() is copied and the
+    //  call returns without waiting for the disk or the
+    //  compressor. propertyDataBorrowed() avoids the copy. At most
+    //  maxQueuedBytes are waiting to be written at any time; the
+    //  caller blocks when the queue is full. close() waits for all of
+    //  the data to be written. Don't use the ostream passed to the
+    //  Writer until it's closed. Text files are always written
+    //  directly. Call before open().
+    //
+
+    void setWriteBehind(bool b, size_t maxQueuedBytes = DefaultMaxQueuedBytes)
+    {
+        m_writeBehind = b;
+        m_maxQueuedBytes = maxQueuedBytes;
+    }
+
+    bool writeBehind() const { return m_writeBehind; }
+
+    static const size_t DefaultMaxQueuedBytes = 256 * 1024 * 1024;
+
     //
     //  Close stream if applicable.
     //
@@ -125,6 +223,13 @@ class Writer
     //
     //  Components can be nested.
     //
+    //  The data of a component with the Transposed flag is written as
+    //  records holding an element of each property (see
+    //  ComponentFlags in Header.h). Its properties must all have the
+    //  same number of elements and are never filtered. The writer
+    //  keeps a copy of the component's data until its last property
+    //  has been written and then writes the records.
+    //
 
     void beginComponent(const char* name, uint32 flags=0);
     void beginComponent(const char* name, const char* interp, uint32 flags=0);
@@ -152,6 +257,27 @@ class Writer
         property(name, type, numElements, Dimensions(width, 0, 0, 0), interp);
     }
 
+    //
+    //  Filters (see PropertyFilter in Header.h) applied to the data of
+    //  properties declared after this call. Filters which don't make
+    //  sense for a property's type are dropped so ShuffleFilter |
+    //  DeltaFilter can be set for a whole component. Text files are
+    //  never filtered.
+    //
+
+    void setPropertyFilters(uint32 filters) { m_filters = filters; }
+    uint32 propertyFilters() const { return m_filters; }
+
+    //
+    //  Float properties declared after setFloatsAsHalf(true) are
+    //  stored as Half. Their data is still passed to the Writer as
+    //  floats and is converted as it's written. Text files keep
+    //  floats.
+    //
+
+    void setFloatsAsHalf(bool b) { m_floatsAsHalf = b; }
+    bool floatsAsHalf() const { return m_floatsAsHalf; }
+
     void endComponent();
 
     //
@@ -205,6 +331,23 @@ class Writer
 
     void emptyProperty() { propertyDataRaw((void*)0); }
 
+    //
+    //  Like propertyDataRaw() but the data is not copied in
+    //  write-behind mode. The data must not change until done is
+    //  called with it and userData. done is called by the background
+    //  thread once the data has been written, or before this function
+    //  returns if the data had to be copied (e.g. when filtering or in
+    //  a text file) or the Writer is not in write-behind mode. It is
+    //  not called if an exception is thrown.
+    //
+
+    void propertyDataBorrowed(const void* data,
+                              DataWrittenFunc done,
+                              void* userData = 0,
+                              const char *propertyName=0,
+                              uint32 size=0, 
+                              const Dimensions& dims = Dimensions(0,0,0,0));
+
     template<typename T>
     void propertyData(const T *data, 
                       const char *propertyName=0,
@@ -217,12 +360,59 @@ class Writer
                       uint32 size=0, 
                       const Dimensions& dims = Dimensions(0,0,0,0));
 
+    //
+    //  The property's data is the concatenation of the spans. The
+    //  spans are written where they are without being gathered into
+    //  one buffer first. Their sizes must add up to the size of the
+    //  property.
+    //
+
+    void propertyDataSpans(const DataSpan* spans,
+                           size_t numSpans,
+                           const char *propertyName=0,
+                           uint32 size=0, 
+                           const Dimensions& dims = Dimensions(0,0,0,0));
+
+    //
+    //  Writes an attribute which is interleaved with other data, e.g.
+    //  a member of an array of structs. Each element of the property
+    //  starts stride bytes after the previous one.
+    //
+
+    void propertyDataStrided(const void* data,
+                             size_t stride,
+                             const char *propertyName=0,
+                             uint32 size=0, 
+                             const Dimensions& dims = Dimensions(0,0,0,0));
+
     template<class T>
     void propertyDataInContainer(const T &container,
                                  const char *propertyName=0,
                                  uint32 size=0, 
                                  const Dimensions& dims = Dimensions(0,0,0,0));
 
+    //
+    //  A property's data can also be written in pieces: call
+    //  beginPropertyData(), then appendPropertyData() as many times as
+    //  needed and finally endPropertyData(). Only the piece being
+    //  appended needs to be in memory. The pieces must add up to the
+    //  declared size of the property. n is the number of T values.
+    //
+
+    void beginPropertyData(const char *propertyName=0,
+                           uint32 size=0, 
+                           const Dimensions& dims = Dimensions(0,0,0,0));
+
+    void appendPropertyDataRaw(const void* data, size_t bytes);
+
+    template<typename T>
+    void appendPropertyData(const T* data, size_t n)
+    {
+        appendPropertyDataRaw(data, n * sizeof(T));
+    }
+
+    void endPropertyData();
+
     void endData();
 
     //
@@ -235,7 +425,15 @@ class Writer
     void init(std::ostream*);
     void constructStringTable(const std::string*, size_t);
     void writeHead();
-    void write(const void*, size_t);
+    void writeFooter();
+    void writeProperty(const void*, const char*, uint32, const Dimensions&,
+                       DataWrittenFunc, void*);
+    void write(const void*, size_t, DataWrittenFunc done = 0, void* = 0);
+    void writeNow(const void*, size_t);
+    void queueWrite(const void*, size_t, DataWrittenFunc, void*);
+    void addWriteJob(WriteJob*);
+    void submitPendingWrites();
+    void finishWrites();
     void write(const std::string&);
     void writeFormatted(const char*, ...);
     void writeIndent(size_t n);
@@ -244,13 +442,41 @@ class Writer
     void writeMaybeQuotedString(const std::string&);
     void flush();
     bool propertySanityCheck(const char*, uint32, const Dimensions&);
+    bool nextProperty(const char*, uint32, const Dimensions&);
+    size_t dataSize(size_t) const;
+    uint64 propertyBytes(size_t) const;
+    void writePropertyPiece(const void*, size_t);
+    void writeStoredPiece(const void*, size_t);
+    void finishPropertyPieces();
+    void writeFilterBlock();
+    bool isTransposed(size_t) const;
+    void stageTransposed(const void*, size_t);
+    void finishTransposed(bool closing = false);
 
   private:
     std::ostream* m_out;
-    void*         m_gzfile;
+    CompressedFile* m_gzfile;
+    ChunkWriter*  m_blocks;
+    size_t        m_blockSize;
+    size_t        m_numThreads;
+    ThreadPool*   m_writeThread;
+    std::deque<WriteJob*> m_writeJobs;
+    std::vector<char> m_pendingWrites;
+    size_t        m_queuedBytes;
+    size_t        m_maxQueuedBytes;
     Objects       m_objects;
     Components    m_components;
     Properties    m_properties;
+    std::vector<uint32> m_propertyFilters;
+    std::vector<bool>   m_propertyAsHalf;
+    std::vector<size_t> m_propertyComponent;
+    std::vector<size_t> m_componentProperties;
+    std::vector< std::vector<char> > m_transposeBuffers;
+    uint32        m_filters;
+    std::vector<char> m_filterBuffer;
+    std::vector<char> m_halfBuffer;
+    std::vector<char> m_appendBuffer;
+    uint64        m_appendBytes;
     PropertyMap   m_propertyMap;
     StringVector  m_names;
     StringVector  m_componentScope;
@@ -258,6 +484,7 @@ class Writer
     std::string   m_outName;
     size_t        m_currentProperty;
     FileType      m_type;
+    uint64        m_bytesWritten;
     bool          m_needsClosing      : 1;
     bool          m_error             : 1;
     bool          m_tableFinished     : 1;
@@ -265,6 +492,14 @@ class Writer
     bool          m_beginDataCalled   : 1;
     bool          m_objectActive      : 1;
     bool          m_componentActive   : 1;
+    bool          m_streaming         : 1;
+    bool          m_footerPending     : 1;
+    bool          m_writeBehind       : 1;
+    bool          m_appending         : 1;
+    bool          m_appendOk          : 1;
+    bool          m_floatsAsHalf      : 1;
+
+    friend struct WriteJob;
 };
 
 template<typename T>
@@ -313,12 +548,32 @@ void Writer::propertyDataInContainer(const T &container,
     {
         propertyDataRaw(0, propertyName, 0, dims);
     }
-    else
+    else if (m_type == TextGTO)
     {
         std::vector<value_type> data(container.size());
         std::copy(container.begin(), container.end(), data.begin());
         propertyDataRaw(&data.front(), propertyName, size, dims);
     }
+    else if (nextProperty(propertyName, size, dims))
+    {
+        //
+        //  Copy the container a block at a time instead of all at once
+        //
+
+        size_t perBlock = std::max(size_t(1), 
+                                   GTO_FILTER_BLOCK / sizeof(value_type));
+        std::vector<value_type> data(std::min(container.size(), perBlock));
+        iterator i = container.begin();
+
+        while (i != container.end())
+        {
+            size_t n = 0;
+            for (; n < data.size() && i != container.end(); ++i) data[n++] = *i;
+            writePropertyPiece(&data.front(), n * sizeof(value_type));
+        }
+
+        finishPropertyPieces();
+    }
 }
 
 } // Gto
@@ -0,0 +1,822 @@
+//
+//  Copyright (c) 2009, Tweak Software
+//  All rights reserved.
+// 
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions
+//  are met:
+//
+//     * Redistributions of source code must retain the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above
+//       copyright notice, this list of conditions and the following
+//       disclaimer in the documentation and/or other materials
+//       provided with the distribution.
+//
+//     * Neither the name of the Tweak Software nor the names of its
+//       contributors may be used to endorse or promote products
+//       derived from this software without specific prior written
+//       permission.
+// 
+//  THIS SOFTWARE IS PROVIDED BY Tweak Software ''AS IS'' AND ANY EXPRESS
+//  OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+//  WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//  ARE DISCLAIMED. IN NO EVENT SHALL Tweak Software BE LIABLE FOR
+//  ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+//  OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+//  BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+//  LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+//  USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+//  DAMAGE.
+#include <Gto/Writer.h>
+#include <Gto/Reader.h>
+#include <Gto/Utilities.h>
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <new>
+#include <sstream>
+#include <vector>
+#include <sys/time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+//
+//  Micro benchmarks for the Gto library. Run with the number of
+//  particles to generate (default 4M) and the number of times each
+//  test should be repeated.
+//
+
+using namespace std;
+
+static double
+seconds()
+{
+    struct timeval tv;
+    gettimeofday(&tv, 0);
+    return double(tv.tv_sec) + double(tv.tv_usec) / 1000000.0;
+}
+
+//
+//  The heap is counted while headers are read. Each block remembers
+//  its size and whether it was counted.
+//
+
+static bool   countHeap  = false;
+static size_t heapBytes  = 0;
+static size_t heapBlocks = 0;
+
+static void*
+allocate(size_t size)
+{
+    size_t* p = (size_t*)malloc(size + 2 * sizeof(size_t));
+    if (!p) return 0;
+
+    p[0] = size;
+    p[1] = countHeap;
+
+    if (countHeap)
+    {
+        heapBytes += size;
+        heapBlocks++;
+    }
+
+    return p + 2;
+}
+
+static void
+deallocate(void* data)
+{
+    if (!data) return;
+    size_t* p = (size_t*)data - 2;
+
+    if (p[1] && countHeap)
+    {
+        heapBytes -= p[0];
+        heapBlocks--;
+    }
+
+    free(p);
+}
+
+//
+//  Dynamic exception specifications are gone from C++17
+//
+
+#if __cplusplus < 201103L
+#define THROW_BAD_ALLOC throw(std::bad_alloc)
+#else
+#define THROW_BAD_ALLOC
+#endif
+
+void* operator new(size_t size) THROW_BAD_ALLOC
+{
+    void* p = allocate(size);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size) THROW_BAD_ALLOC { return operator new(size); }
+void* operator new(size_t size, const std::nothrow_t&) throw() { return allocate(size); }
+void* operator new[](size_t size, const std::nothrow_t&) throw() { return allocate(size); }
+void operator delete(void* p) throw() { deallocate(p); }
+void operator delete[](void* p) throw() { deallocate(p); }
+void operator delete(void* p, const std::nothrow_t&) throw() { deallocate(p); }
+void operator delete[](void* p, const std::nothrow_t&) throw() { deallocate(p); }
+
+//
+//  Writes a particle cache with n particles
+//
+
+static void
+writeParticles(Gto::Writer& writer, size_t n, Gto::uint32 flags = 0)
+{
+    vector<float> positions(n * 3);
+    vector<float> velocities(n * 3);
+    vector<int>   ids(n);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        positions[i*3+0]  = float(i) * 0.1f;
+        positions[i*3+1]  = float(i % 1000) * 0.01f;
+        positions[i*3+2]  = float(i % 17);
+        velocities[i*3+0] = 1.0f;
+        velocities[i*3+1] = float(i % 3);
+        velocities[i*3+2] = -1.0f;
+        ids[i]            = int(i);
+    }
+
+    writer.beginObject("particles", "particle", 1);
+        writer.beginComponent("points", flags);
+            writer.property("position", Gto::Float, n, 3);
+            writer.property("velocity", Gto::Float, n, 3);
+            writer.property("id", Gto::Int, n, 1);
+        writer.endComponent();
+    writer.endObject();
+
+    writer.beginData();
+        writer.propertyData(positions);
+        writer.propertyData(velocities);
+        writer.propertyData(ids);
+    writer.endData();
+    writer.close();
+}
+
+//
+//  Generates a particle cache in memory
+//
+
+static string
+makeParticles(size_t n, 
+              Gto::Writer::FileType type = Gto::Writer::BinaryGTO,
+              Gto::uint32 filters = Gto::NoFilter)
+{
+    ostringstream out;
+    Gto::Writer writer(out);
+    writer.open(out, type);
+    writer.setPropertyFilters(filters);
+    writeParticles(writer, n);
+    return out.str();
+}
+
+//
+//  Copies or borrows all of the property data
+//
+
+class BenchReader : public Gto::Reader
+{
+public:
+    BenchReader(unsigned int mode, bool borrow) 
+        : Gto::Reader(mode), m_borrow(borrow), checksum(0) {}
+
+    virtual void* data(const PropertyInfo& info, size_t bytes)
+    {
+        m_buffer.resize(bytes);
+        return bytes ? &m_buffer.front() : 0;
+    }
+
+    virtual bool dataView(const PropertyInfo& info, const void* p, size_t bytes)
+    {
+        if (!m_borrow) return false;
+        checksum += ((const unsigned char*)p)[bytes - 1];
+        return true;
+    }
+
+    virtual void dataRead(const PropertyInfo& info)
+    {
+        if (!m_buffer.empty()) checksum += (unsigned char)m_buffer.back();
+    }
+
+private:
+    bool         m_borrow;
+    vector<char> m_buffer;
+
+public:
+    size_t       checksum;
+};
+
+static void
+report(const char* name, double t, size_t bytes, size_t repeat)
+{
+    double mb = double(bytes * repeat) / (1024.0 * 1024.0);
+    printf("%-24s %10.3f ms %10.1f MB/s\n", name, t * 1000.0 / repeat, mb / t);
+}
+
+static void
+benchInRAM(const string& file, size_t repeat)
+{
+    const char* names[] = { "in-memory (copy)", "in-memory (borrow)" };
+
+    for (int borrow = 0; borrow < 2; borrow++)
+    {
+        double t0 = seconds();
+
+        for (size_t i = 0; i < repeat; i++)
+        {
+            BenchReader reader(Gto::Reader::None, borrow != 0);
+            reader.open(file.data(), file.size(), "bench");
+        }
+
+        report(names[borrow], seconds() - t0, file.size(), repeat);
+    }
+}
+
+static void
+benchStream(const string& file, size_t repeat)
+{
+    double t0 = seconds();
+
+    for (size_t i = 0; i < repeat; i++)
+    {
+        istringstream in(file);
+        BenchReader reader(Gto::Reader::None, false);
+        reader.open(in, "bench");
+    }
+
+    report("istream", seconds() - t0, file.size(), repeat);
+}
+
+static void
+benchFile(const string& file, size_t repeat)
+{
+    const char* filename = "bench_particles.gto";
+
+    {
+        ofstream out(filename, ios::out|ios::binary);
+        out.write(file.data(), file.size());
+    }
+
+    double t0 = seconds();
+
+    for (size_t i = 0; i < repeat; i++)
+    {
+        BenchReader reader(Gto::Reader::None, false);
+        reader.open(filename);
+    }
+
+    report("file", seconds() - t0, file.size(), repeat);
+    t0 = seconds();
+
+    for (size_t i = 0; i < repeat; i++)
+    {
+        BenchReader reader(Gto::Reader::MemoryMapped, true);
+        reader.open(filename);
+    }
+
+    report("file (mapped, borrow)", seconds() - t0, file.size(), repeat);
+    unlink(filename);
+}
+
+static void
+benchBlocks(size_t n, size_t repeat)
+{
+    string file = makeParticles(n, Gto::Writer::BlockCompressedGTO);
+    printf("block compressed: %lu bytes\n", (unsigned long)file.size());
+
+    size_t threads[] = { 1, 0 };
+    const char* names[] = { "blocks (1 thread)", "blocks (all threads)" };
+
+    for (int t = 0; t < 2; t++)
+    {
+        double t0 = seconds();
+
+        for (size_t i = 0; i < repeat; i++)
+        {
+            BenchReader reader(Gto::Reader::None, false);
+            reader.setNumThreads(threads[t]);
+            reader.open(file.data(), file.size(), "bench");
+        }
+
+        report(names[t], seconds() - t0, file.size(), repeat);
+    }
+}
+
+//
+//  Decompression speed of each block codec. The rate is for the
+//  uncompressed data.
+//
+
+static void
+benchCodecs(size_t n, size_t bytes, size_t repeat)
+{
+    Gto::Writer::FileType types[] = { Gto::Writer::BlockCompressedGTO,
+                                      Gto::Writer::LZ4CompressedGTO,
+                                      Gto::Writer::ZstdCompressedGTO };
+    const char* names[] = { "codec zlib", "codec lz4", "codec zstd" };
+
+    for (int c = 0; c < 3; c++)
+    {
+        string file = makeParticles(n, types[c]);
+        double t0   = seconds();
+
+        for (size_t i = 0; i < repeat; i++)
+        {
+            BenchReader reader(Gto::Reader::None, false);
+            reader.open(file.data(), file.size(), "bench");
+        }
+
+        report(names[c], seconds() - t0, bytes, repeat);
+        printf("%-24s %10lu bytes\n", "", (unsigned long)file.size());
+    }
+}
+
+//
+//  Block compressed files with and without the shuffle and delta
+//  filters
+//
+
+static void
+benchFilters(size_t n, size_t bytes, size_t repeat)
+{
+    Gto::Writer::FileType types[] = { Gto::Writer::BlockCompressedGTO,
+                                      Gto::Writer::LZ4CompressedGTO };
+    const char* names[] = { "zlib", "zlib filtered", "lz4", "lz4 filtered" };
+
+    for (int c = 0; c < 4; c++)
+    {
+        Gto::uint32 filters = c % 2 ? Gto::AllFilters : Gto::NoFilter;
+        string file = makeParticles(n, types[c / 2], filters);
+        double t0   = seconds();
+
+        for (size_t i = 0; i < repeat; i++)
+        {
+            BenchReader reader(Gto::Reader::None, false);
+            reader.open(file.data(), file.size(), "bench");
+        }
+
+        report(names[c], seconds() - t0, bytes, repeat);
+        printf("%-24s %10lu bytes\n", "", (unsigned long)file.size());
+    }
+}
+
+//
+//  Reading files straight through with and without the read ahead
+//  thread. The rate is for the uncompressed data.
+//
+
+static void
+benchReadAhead(size_t n, size_t bytes, size_t repeat)
+{
+    const char* filename = "bench_particles.gto";
+    Gto::Writer::FileType types[] = { Gto::Writer::BinaryGTO,
+                                      Gto::Writer::CompressedGTO };
+    const char* names[] = { "file", 
+                            "file (read ahead)",
+                            "gzip file",
+                            "gzip file (read ahead)" };
+
+    for (int c = 0; c < 4; c++)
+    {
+        if (c % 2 == 0)
+        {
+            Gto::Writer writer;
+            writer.open(filename, types[c / 2]);
+            writeParticles(writer, n);
+        }
+
+        unsigned int mode = c % 2 ? Gto::Reader::ReadAhead : Gto::Reader::None;
+        double t0 = seconds();
+
+        for (size_t i = 0; i < repeat; i++)
+        {
+            BenchReader reader(mode, false);
+            reader.open(filename);
+        }
+
+        report(names[c], seconds() - t0, bytes, repeat);
+    }
+
+    unlink(filename);
+}
+
+//
+//  HeaderOnly opens of a file with a large header, as when scanning a
+//  directory of caches: numObjects objects with ten properties each.
+//  The rate is for the whole file. The heap left in use by the Reader
+//  after the header has been read is reported for the normal and
+//  CompactHeader modes, and so is the time to find each property by
+//  its path.
+//
+
+static void
+benchHeader(size_t numObjects, size_t repeat)
+{
+    const char* filename = "bench_header.gto";
+    const size_t numProperties = 10;
+
+    {
+        Gto::Writer writer;
+        writer.open(filename, Gto::Writer::BinaryGTO);
+
+        for (size_t i = 0; i < numObjects; i++)
+        {
+            ostringstream name;
+            name << "character_" << i << "_geometry";
+            writer.beginObject(name.str().c_str(), "polygon", 2);
+                writer.beginComponent("points");
+
+                for (size_t q = 0; q < numProperties; q++)
+                {
+                    ostringstream pname;
+                    pname << "attribute_" << q;
+                    writer.property(pname.str().c_str(), Gto::Float, 0, 3);
+                }
+
+                writer.endComponent();
+            writer.endObject();
+        }
+
+        writer.beginData();
+
+        for (size_t i = 0; i < numObjects * numProperties; i++)
+        {
+            writer.propertyData((float*)0);
+        }
+
+        writer.endData();
+    }
+
+    ifstream in(filename, ios::in|ios::binary);
+    string file((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+
+    const char* names[] = { "header only (file)",
+                            "header only (in-memory)",
+                            "compact header (file)",
+                            "compact header (in-memory)" };
+
+    for (int c = 0; c < 4; c++)
+    {
+        unsigned int mode = Gto::Reader::HeaderOnly;
+        if (c >= 2) mode |= Gto::Reader::CompactHeader;
+        size_t bytes  = 0;
+        size_t blocks = 0;
+        double t0     = seconds();
+
+        for (size_t i = 0; i < repeat; i++)
+        {
+            Gto::Reader reader(mode);
+            heapBytes  = 0;
+            heapBlocks = 0;
+            countHeap  = true;
+
+            if (c % 2) reader.open(file.data(), file.size(), "bench");
+            else reader.open(filename);
+
+            bytes     = heapBytes;
+            blocks    = heapBlocks;
+            countHeap = false;
+        }
+
+        report(names[c], seconds() - t0, file.size(), repeat);
+        printf("%-24s %10.1f MB %10lu blocks\n", "  heap in use", 
+               double(bytes) / (1024.0 * 1024.0), (unsigned long)blocks);
+    }
+
+    Gto::Reader reader(Gto::Reader::HeaderOnly);
+    reader.open(file.data(), file.size(), "bench");
+
+    vector<string>           paths;
+    Gto::Reader::Properties& properties = reader.properties();
+
+    for (size_t i = 0; i < properties.size(); i++)
+    {
+        const Gto::Reader::PropertyInfo& p = properties[i];
+        paths.push_back(reader.stringFromId(p.component->object->name) + "." + p.fullName);
+    }
+
+    size_t found = 0;
+    double t0    = seconds();
+
+    for (size_t i = 0; i < paths.size(); i++)
+    {
+        if (reader.findProperty(paths[i])) found++;
+    }
+
+    double t = seconds() - t0;
+    printf("%-24s %10.3f us %10lu found\n", "find property", 
+           t * 1000000.0 / paths.size(), (unsigned long)found);
+
+    unlink(filename);
+}
+
+//
+//  Compression speed with one thread and with all of them. The rate
+//  is for the uncompressed data.
+//
+
+static void
+benchWrite(size_t n, size_t bytes, size_t repeat)
+{
+    const char* filename = "bench_particles.gto";
+    Gto::Writer::FileType types[] = { Gto::Writer::CompressedGTO,
+                                      Gto::Writer::BlockCompressedGTO };
+    const char* names[] = { "write gzip (1 thread)", 
+                            "write gzip (all threads)",
+                            "write blocks (1 thread)",
+                            "write blocks (all threads)" };
+
+    for (int c = 0; c < 4; c++)
+    {
+        double t0 = seconds();
+
+        for (size_t i = 0; i < repeat; i++)
+        {
+            Gto::Writer writer;
+            writer.setNumThreads(c % 2 ? 0 : 1);
+            writer.open(filename, types[c / 2]);
+            writeParticles(writer, n);
+        }
+
+        report(names[c], seconds() - t0, bytes, repeat);
+    }
+
+    unlink(filename);
+}
+
+//
+//  Reading byte swapped data (as written on a machine of the other
+//  endianness) from memory for each type, compared with unswapped
+//  data and with a copy followed by a scalar swap pass
+//
+
+static string
+makeTyped(size_t n, Gto::DataType type)
+{
+    vector<char> values(n * Gto::dataSizeInBytes(type));
+    for (size_t i = 0; i < values.size(); i++) values[i] = char(i * 31);
+
+    ostringstream out;
+    Gto::Writer writer(out);
+    writer.open(out, Gto::Writer::BinaryGTO);
+    writer.beginObject("typed", "data", 1);
+        writer.beginComponent("values");
+            writer.property("values", type, n);
+        writer.endComponent();
+    writer.endObject();
+    writer.beginData();
+        writer.propertyDataRaw(&values.front());
+    writer.endData();
+    writer.close();
+    return out.str();
+}
+
+static string
+byteSwapped(const string& file)
+{
+    string swapped = file;
+    Gto::Reader reader(Gto::Reader::RandomAccess);
+    reader.open(file.data(), file.size(), "bench");
+
+    size_t headers = sizeof(Gto::Header);
+
+    for (size_t i = 0; i < reader.stringTable().size(); i++)
+    {
+        headers += reader.stringTable()[i].size() + 1;
+    }
+
+    const Gto::Reader::PropertyInfo& p = reader.properties().front();
+    char* data = &swapped[0];
+
+    Gto::swapData(data, sizeof(Gto::Header) / 4, Gto::Int);
+    Gto::swapData(data + headers, (p.offset - headers) / 4, Gto::Int);
+    Gto::swapData(data + p.offset, p.size, p.type);
+    return swapped;
+}
+
+//
+//  Reading a transposed particle cache (stored as records) from memory
+//  with the records transposed back or as they are
+//
+
+class RecordsReader : public BenchReader
+{
+public:
+    RecordsReader(bool asIs) : BenchReader(Gto::Reader::None, false), m_asIs(asIs) {}
+
+    virtual void* transposedData(const ComponentInfo&, size_t bytes)
+    {
+        if (!m_asIs) return 0;
+        m_records.resize(bytes);
+        return &m_records.front();
+    }
+
+private:
+    bool         m_asIs;
+    vector<char> m_records;
+};
+
+static void
+benchTransposed(size_t n, size_t bytes, size_t repeat)
+{
+    ostringstream out;
+    Gto::Writer writer(out);
+    writer.open(out, Gto::Writer::BinaryGTO);
+    writeParticles(writer, n, Gto::Transposed);
+    string file = out.str();
+
+    const char* names[] = { "transposed", "transposed (records)" };
+
+    for (int asIs = 0; asIs < 2; asIs++)
+    {
+        double t0 = seconds();
+
+        for (size_t i = 0; i < repeat; i++)
+        {
+            RecordsReader reader(asIs != 0);
+            reader.open(file.data(), file.size(), "bench");
+        }
+
+        report(names[asIs], seconds() - t0, bytes, repeat);
+    }
+}
+
+//
+//  Half conversion a value at a time and with the array kernels, and a
+//  particle cache stored as halfs read back as floats. The rates are
+//  for the float data.
+//
+
+class FloatReader : public BenchReader
+{
+public:
+    FloatReader() : BenchReader(Gto::Reader::None, false) {}
+
+    virtual Request property(const string& name,
+                             const string& interp,
+                             const PropertyInfo& info)
+    {
+        return Request(true, 0, info.type == Gto::Half ? Gto::Float 
+                                                       : Gto::DataType(info.type));
+    }
+};
+
+static void
+benchHalfs(size_t n, size_t repeat)
+{
+    vector<float>        floats(n);
+    vector<Gto::uint16>  halfs(n);
+    const size_t         bytes = n * sizeof(float);
+
+    for (size_t i = 0; i < n; i++) floats[i] = float(i % 10007) * 0.37f - 1000.0f;
+
+    double t0 = seconds();
+
+    for (size_t r = 0; r < repeat; r++)
+    {
+        for (size_t i = 0; i < n; i++) halfs[i] = Gto::floatToHalf(floats[i]);
+    }
+
+    report("float to half (scalar)", seconds() - t0, bytes, repeat);
+    t0 = seconds();
+
+    for (size_t r = 0; r < repeat; r++)
+    {
+        Gto::floatToHalf(&floats.front(), &halfs.front(), n);
+    }
+
+    report("float to half", seconds() - t0, bytes, repeat);
+    t0 = seconds();
+
+    for (size_t r = 0; r < repeat; r++)
+    {
+        for (size_t i = 0; i < n; i++) floats[i] = Gto::halfToFloat(halfs[i]);
+    }
+
+    report("half to float (scalar)", seconds() - t0, bytes, repeat);
+    t0 = seconds();
+
+    for (size_t r = 0; r < repeat; r++)
+    {
+        Gto::halfToFloat(&halfs.front(), &floats.front(), n);
+    }
+
+    report("half to float", seconds() - t0, bytes, repeat);
+
+    const size_t particles = n / 7;
+    const char*  names[]   = { "floats", "halfs read as floats" };
+
+    for (int h = 0; h < 2; h++)
+    {
+        ostringstream out;
+        Gto::Writer writer(out);
+        writer.open(out, Gto::Writer::BinaryGTO);
+        writer.setFloatsAsHalf(h != 0);
+        writeParticles(writer, particles);
+        string file = out.str();
+
+        t0 = seconds();
+
+        for (size_t i = 0; i < repeat; i++)
+        {
+            FloatReader reader;
+            reader.open(file.data(), file.size(), "bench");
+        }
+
+        report(names[h], seconds() - t0, particles * 7 * sizeof(float), repeat);
+        printf("%-24s %10lu bytes\n", "", (unsigned long)file.size());
+    }
+}
+
+static void
+scalarSwap(char* p, size_t num, size_t wordSize)
+{
+    for (size_t i = 0; i < num; i++, p += wordSize) std::reverse(p, p + wordSize);
+}
+
+static void
+benchSwapped(size_t n, size_t repeat)
+{
+    const Gto::DataType types[] = { Gto::Float, Gto::Double, Gto::Int, 
+                                    Gto::Short, Gto::Half, Gto::Byte };
+
+    for (int t = 0; t < 6; t++)
+    {
+        string native   = makeTyped(n, types[t]);
+        string swapped  = byteSwapped(native);
+        size_t wordSize = Gto::dataSizeInBytes(types[t]);
+        size_t bytes    = n * wordSize;
+        string name     = Gto::typeName(types[t]);
+
+        double t0 = seconds();
+
+        for (size_t i = 0; i < repeat; i++)
+        {
+            BenchReader reader(Gto::Reader::None, false);
+            reader.open(native.data(), native.size(), "bench");
+        }
+
+        report((name + " native").c_str(), seconds() - t0, bytes, repeat);
+        t0 = seconds();
+
+        for (size_t i = 0; i < repeat; i++)
+        {
+            BenchReader reader(Gto::Reader::None, false);
+            reader.open(swapped.data(), swapped.size(), "bench");
+        }
+
+        report((name + " swapped").c_str(), seconds() - t0, bytes, repeat);
+
+        vector<char> buffer(bytes);
+        const char*  source = swapped.data() + (swapped.size() - bytes);
+        t0 = seconds();
+
+        for (size_t i = 0; i < repeat; i++)
+        {
+            memcpy(&buffer.front(), source, bytes);
+            if (wordSize > 1) scalarSwap(&buffer.front(), n, wordSize);
+        }
+
+        report((name + " copy + swap").c_str(), seconds() - t0, bytes, repeat);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    size_t n      = argc > 1 ? atol(argv[1]) : 4 * 1024 * 1024;
+    size_t repeat = argc > 2 ? atol(argv[2]) : 5;
+
+    string file = makeParticles(n);
+    printf("%lu particles, %lu bytes, %lu repeats\n", 
+           (unsigned long)n, (unsigned long)file.size(), (unsigned long)repeat);
+
+    benchInRAM(file, repeat);
+    benchStream(file, repeat);
+    benchFile(file, repeat);
+    benchBlocks(n, repeat);
+    benchCodecs(n, file.size(), repeat);
+    benchFilters(n, file.size(), repeat);
+    benchReadAhead(n, file.size(), repeat);
+    benchWrite(n, file.size(), repeat);
+    benchHeader(n / 40, repeat);
+    benchSwapped(n * 3, repeat);
+    benchTransposed(n, file.size(), repeat);
+    benchHalfs(n * 3, repeat);
+    return 0;
+}
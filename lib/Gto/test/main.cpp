@@ -35,10 +35,19 @@
 //
 #include <Gto/Writer.h>
 #include <Gto/Reader.h>
+#include <Gto/Codec.h>
+#include <algorithm>
+#include <deque>
 #include <iostream>
+#include <iterator>
+#include <list>
+#include <map>
+#include <fstream>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sstream>
 #include <stdio.h>
+#include <stdlib.h>
 #include <unistd.h>
 
 using namespace std;
@@ -46,11 +55,66 @@ using namespace std;
 float fdata[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
 int   idata[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
 
-void write(const char *filename)
+//
+//  Checks that every property read matches the data written by write().
+//  Each property gets its own buffer since AsyncIO asks for all of
+//  them before any are read.
+//
+
+class TestReader : public Gto::Reader
+{
+public:
+    TestReader(unsigned int mode = None) 
+        : Gto::Reader(mode), numRead(0), numViewed(0), errors(0) {}
+
+    virtual void* data(const PropertyInfo& info, size_t bytes)
+    {
+        vector<char>& buffer = m_buffers[&info];
+        buffer.resize(bytes);
+        return &buffer.front();
+    }
+
+    virtual bool dataView(const PropertyInfo& info, const void* p, size_t bytes)
+    {
+        numViewed++;
+        m_buffers[&info].assign((const char*)p, (const char*)p + bytes);
+        return true;
+    }
+
+    virtual void dataRead(const PropertyInfo& info)
+    {
+        const void* expected = info.type == Gto::Float ? (void*)fdata : (void*)idata;
+        vector<char>& buffer = m_buffers[&info];
+
+        if (buffer.size() != sizeof(fdata) || 
+            memcmp(&buffer.front(), expected, sizeof(fdata)))
+        {
+            cerr << "ERROR: bad data for " << info.fullName << endl;
+            errors++;
+        }
+
+        m_buffers.erase(&info);
+        numRead++;
+    }
+
+    size_t numRead;
+    size_t numViewed;
+    size_t errors;
+
+private:
+    map<const PropertyInfo*, vector<char> > m_buffers;
+};
+
+void write(const char *filename, 
+           Gto::Writer::FileType type = Gto::Writer::CompressedGTO,
+           size_t blockSize = 0,
+           size_t numThreads = 1)
 {
     cout << "writing " << filename << endl;
     Gto::Writer writer;
-    writer.open(filename);
+    if (blockSize) writer.setBlockSize(blockSize);
+    writer.setNumThreads(numThreads);
+    writer.open(filename, type);
 
     writer.beginObject("test", "data", 0);
         writer.beginComponent("component_1");
@@ -81,6 +145,104 @@ void write(const char *filename)
     writer.endData();
 }
 
+//
+//  Same contents as write() but each property's data is written as
+//  soon as it's declared
+//
+
+void writeStreamed(const char *filename, 
+                   Gto::Writer::FileType type = Gto::Writer::CompressedGTO)
+{
+    cout << "writing " << filename << " streamed" << endl;
+    Gto::Writer writer;
+    writer.setStreaming(true);
+    writer.open(filename, type);
+
+    writer.beginObject("test", "data", 0);
+        writer.beginComponent("component_1");
+            writer.property("property_1", Gto::Float, 10);
+            writer.propertyData(fdata);
+            writer.property("property_2", Gto::Float, 10);
+            writer.propertyData(fdata);
+            writer.property("property_3", Gto::Int, 10);
+            writer.propertyData(idata);
+        writer.endComponent();
+    writer.endObject();
+
+    writer.beginObject("test2", "data", 0);
+        writer.beginComponent("component_1");
+            writer.property("property_1", Gto::Float, 10);
+            writer.property("property_2", Gto::Float, 10);
+            writer.propertyData(fdata);
+            writer.propertyData(fdata);
+            writer.property("property_3", Gto::Int, 10);
+            writer.propertyData(idata);
+            writer.property("property_4", Gto::Int, 10);
+            writer.propertyData(idata);
+        writer.endComponent();
+    writer.endObject();
+}
+
+//
+//  Same contents as write() but written by the write-behind thread
+//  from borrowed data
+//
+
+static void countWritten(const void*, void* count)
+{
+    (*(int*)count)++;
+}
+
+int writeBorrowed(const char *filename, 
+                  Gto::Writer::FileType type = Gto::Writer::CompressedGTO)
+{
+    cout << "writing " << filename << " write-behind" << endl;
+    int numWritten = 0;
+
+    {
+        Gto::Writer writer;
+        writer.setWriteBehind(true, 16);
+        writer.open(filename, type);
+
+        writer.beginObject("test", "data", 0);
+            writer.beginComponent("component_1");
+                writer.property("property_1", Gto::Float, 10);
+                writer.property("property_2", Gto::Float, 10);
+                writer.property("property_3", Gto::Int, 10);
+            writer.endComponent();
+        writer.endObject();
+
+        writer.beginObject("test2", "data", 0);
+            writer.beginComponent("component_1");
+                writer.property("property_1", Gto::Float, 10);
+                writer.property("property_2", Gto::Float, 10);
+                writer.property("property_3", Gto::Int, 10);
+                writer.property("property_4", Gto::Int, 10);
+            writer.endComponent();
+        writer.endObject();
+
+        writer.beginData();
+            writer.propertyDataBorrowed(fdata, countWritten, &numWritten);
+            writer.propertyDataBorrowed(fdata, countWritten, &numWritten);
+            writer.propertyDataBorrowed(idata, countWritten, &numWritten);
+
+            writer.propertyDataBorrowed(fdata, countWritten, &numWritten);
+            writer.propertyDataBorrowed(fdata, countWritten, &numWritten);
+            writer.propertyDataBorrowed(idata, countWritten, &numWritten);
+            writer.propertyDataBorrowed(idata, countWritten, &numWritten);
+        writer.endData();
+    }
+
+    if (numWritten != 7)
+    {
+        cerr << "ERROR: " << numWritten << " of 7 borrowed properties "
+             << "were reported written" << endl;
+        return 1;
+    }
+
+    return 0;
+}
+
 void read(const char *filename)
 {
     cout << "reading " << filename << endl;
@@ -88,13 +250,1922 @@ void read(const char *filename)
     reader.open(filename);
 }
 
+int readMapped(const char *filename, bool inPlace)
+{
+    cout << "reading " << filename << " mapped" << endl;
+    TestReader reader(Gto::Reader::MemoryMapped);
+
+    if (!reader.open(filename) || reader.numRead != 7 || reader.errors)
+    {
+        cerr << "ERROR: mapped read failed: " << reader.why() << endl;
+        return 1;
+    }
+
+#ifdef GTO_SUPPORT_MMAP
+    if (reader.numViewed != (inPlace ? 7 : 0))
+    {
+        cerr << "ERROR: mapped read did not use the mapping" << endl;
+        return 1;
+    }
+#endif
+
+    return 0;
+}
+
+int readAll(const char *filename)
+{
+    cout << "reading " << filename << " (checked)" << endl;
+    TestReader reader;
+
+    if (!reader.open(filename) || reader.numRead != 7 || reader.errors)
+    {
+        cerr << "ERROR: read failed: " << reader.why() << endl;
+        return 1;
+    }
+
+    TestReader treader;
+    treader.setNumThreads(4);
+
+    if (!treader.open(filename) || treader.numRead != 7 || treader.errors)
+    {
+        cerr << "ERROR: threaded read failed: " << treader.why() << endl;
+        return 1;
+    }
+
+    ifstream in(filename, ios::in|ios::binary);
+    TestReader sreader;
+
+    if (!sreader.open(in, filename) || sreader.numRead != 7 || sreader.errors)
+    {
+        cerr << "ERROR: stream read failed: " << sreader.why() << endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+//
+//  A small read ahead ring so reads, gets and skipped properties all
+//  cross buffer boundaries
+//
+
+class SkippingReader : public TestReader
+{
+public:
+    SkippingReader(unsigned int mode) : TestReader(mode) {}
+
+    virtual Request property(const string& name,
+                             const string& interp,
+                             const PropertyInfo& info)
+    {
+        return Request(name != "property_2");
+    }
+};
+
+int readAhead(const char *filename)
+{
+    cout << "reading " << filename << " ahead" << endl;
+    TestReader reader(Gto::Reader::ReadAhead);
+    reader.setReadAhead(17, 3);
+
+    if (!reader.open(filename) || reader.numRead != 7 || reader.errors)
+    {
+        cerr << "ERROR: read ahead failed: " << reader.why() << endl;
+        return 1;
+    }
+
+    SkippingReader sreader(Gto::Reader::ReadAhead);
+    sreader.setReadAhead(17, 2);
+
+    if (!sreader.open(filename) || sreader.numRead != 5 || sreader.errors)
+    {
+        cerr << "ERROR: skipping read ahead failed: " << sreader.why() << endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+//
+//  A string table big enough to cross the read ahead buffers and
+//  blocks, checked through each kind of source
+//
+
+string objectName(size_t i)
+{
+    ostringstream str;
+    str << "object_" << i << "_" << string(i % 40, 'x');
+    return str.str();
+}
+
+int checkStrings(Gto::Reader& reader, size_t numObjects, const char* how)
+{
+    if (reader.objects().size() != numObjects)
+    {
+        cerr << "ERROR: " << how << " string read failed: " << reader.why() << endl;
+        return 1;
+    }
+
+    for (size_t i = 0; i < numObjects; i++)
+    {
+        string name = objectName(i);
+        unsigned int id = reader.idFromString(name);
+        Gto::Reader::StringRef ref = reader.stringRefFromId(id);
+
+        if (id != reader.objects()[i].name ||
+            reader.stringFromId(id) != name ||
+            ref.size != name.size() || memcmp(ref.data, name.c_str(), ref.size + 1))
+        {
+            cerr << "ERROR: " << how << " bad string " << name << endl;
+            return 1;
+        }
+    }
+
+    if (reader.stringTable().size() != numObjects + 4)
+    {
+        cerr << "ERROR: " << how << " bad string table" << endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+int readStrings(const char* filename, Gto::Writer::FileType type)
+{
+    cout << "writing and reading " << filename << " strings" << endl;
+    const size_t numObjects = 3000;
+
+    {
+        Gto::Writer writer;
+        writer.setBlockSize(1000);
+        writer.open(filename, type);
+
+        for (size_t i = 0; i < numObjects; i++)
+        {
+            writer.beginObject(objectName(i).c_str(), "data", 0);
+                writer.beginComponent("points");
+                    writer.property("position", Gto::Float, 1);
+                writer.endComponent();
+            writer.endObject();
+        }
+
+        writer.beginData();
+        for (size_t i = 0; i < numObjects; i++) writer.propertyData(fdata);
+        writer.endData();
+    }
+
+    int errors = 0;
+
+    Gto::Reader reader(Gto::Reader::HeaderOnly);
+    reader.open(filename);
+    errors += checkStrings(reader, numObjects, "file");
+
+    Gto::Reader areader(Gto::Reader::ReadAhead);
+    areader.setReadAhead(100, 3);
+    areader.open(filename);
+    errors += checkStrings(areader, numObjects, "read ahead");
+
+    if (type != Gto::Writer::CompressedGTO)
+    {
+        ifstream in(filename, ios::in|ios::binary);
+        Gto::Reader sreader(Gto::Reader::HeaderOnly);
+        sreader.open(in, filename);
+        errors += checkStrings(sreader, numObjects, "stream");
+
+        ifstream file(filename, ios::in|ios::binary);
+        vector<char> bytes((istreambuf_iterator<char>(file)), 
+                           istreambuf_iterator<char>());
+        Gto::Reader mreader(Gto::Reader::HeaderOnly);
+        mreader.open(&bytes.front(), bytes.size(), filename);
+        errors += checkStrings(mreader, numObjects, "in memory");
+    }
+
+    unlink(filename);
+    return errors;
+}
+
+//
+//  Nested components read with and without CompactHeader must have
+//  the same full names, and both must be found by name
+//
+
+int readCompact(const char* filename)
+{
+    cout << "writing and reading " << filename << " compact" << endl;
+
+    {
+        Gto::Writer writer;
+        writer.open(filename, Gto::Writer::BinaryGTO);
+
+        for (size_t i = 0; i < 100; i++)
+        {
+            writer.beginObject(objectName(i).c_str(), "data", 0);
+                writer.beginComponent("outer");
+                    writer.property("p", Gto::Float, 10);
+                    writer.beginComponent("middle");
+                        writer.property("p", Gto::Float, 10);
+                        writer.beginComponent("inner");
+                            writer.property("p", Gto::Float, 10);
+                        writer.endComponent();
+                    writer.endComponent();
+                    writer.beginComponent("sibling");
+                        writer.property("p", Gto::Float, 10);
+                    writer.endComponent();
+                writer.endComponent();
+                writer.beginComponent("points");
+                    writer.property("position", Gto::Float, 10);
+                writer.endComponent();
+            writer.endObject();
+        }
+
+        writer.beginData();
+        for (size_t i = 0; i < 500; i++) writer.propertyData(fdata);
+        writer.endData();
+    }
+
+    Gto::Reader reader(Gto::Reader::HeaderOnly);
+    Gto::Reader creader(Gto::Reader::HeaderOnly | Gto::Reader::CompactHeader);
+    reader.open(filename);
+    creader.open(filename);
+    unlink(filename);
+
+    Gto::Reader::Components& components  = reader.components();
+    Gto::Reader::Components& ccomponents = creader.components();
+    Gto::Reader::Properties& properties  = reader.properties();
+    Gto::Reader::Properties& cproperties = creader.properties();
+
+    if (components.size() != 500 || ccomponents.size() != 500 ||
+        properties.size() != 500 || cproperties.size() != 500 ||
+        components[2].fullName != "outer.middle.inner")
+    {
+        cerr << "ERROR: compact read failed: " << creader.why() << endl;
+        return 1;
+    }
+
+    for (size_t i = 0; i < components.size(); i++)
+    {
+        string path = objectName(i / 5) + "." + components[i].fullName;
+
+        if (!ccomponents[i].fullName.empty() ||
+            creader.fullName(ccomponents[i]) != components[i].fullName ||
+            reader.fullName(components[i]) != components[i].fullName ||
+            creader.findComponent(path) != &ccomponents[i] ||
+            reader.findComponent(path) != &components[i])
+        {
+            cerr << "ERROR: bad compact name for " << components[i].fullName << endl;
+            return 1;
+        }
+    }
+
+    for (size_t i = 0; i < properties.size(); i++)
+    {
+        string path = objectName(i / 5) + "." + properties[i].fullName;
+
+        if (!cproperties[i].fullName.empty() ||
+            creader.fullName(cproperties[i]) != properties[i].fullName ||
+            creader.findProperty(path) != &cproperties[i] ||
+            creader.findComponent(path) != 0)
+        {
+            cerr << "ERROR: bad compact name for " << properties[i].fullName << endl;
+            return 1;
+        }
+    }
+
+    for (size_t i = 0; i < 100; i++)
+    {
+        if (creader.findObject(objectName(i)) != &creader.objects()[i] ||
+            creader.findProperty(objectName(i) + ".outer") != 0 ||
+            creader.findProperty(objectName(i) + ".outer.p.") != 0)
+        {
+            cerr << "ERROR: bad lookup for " << objectName(i) << endl;
+            return 1;
+        }
+    }
+
+    if (creader.findObject("object") || creader.findComponent("outer.middle") ||
+        creader.idFromString("middle") == unsigned(-1))
+    {
+        cerr << "ERROR: bad lookup" << endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+//
+//  Reads the file from write() with the floats converted to doubles
+//  and the ints to shorts, from each kind of source
+//
+
+class ConvertingReader : public Gto::Reader
+{
+public:
+    ConvertingReader(unsigned int mode = None) 
+        : Gto::Reader(mode), numRead(0), errors(0) {}
+
+    virtual Request property(const string& name,
+                             const string& interp,
+                             const PropertyInfo& info)
+    {
+        return Request(true, 0, info.type == Gto::Float ? Gto::Double : Gto::Short);
+    }
+
+    virtual void* data(const PropertyInfo& info, size_t bytes)
+    {
+        m_buffer.resize(bytes);
+        return &m_buffer.front();
+    }
+
+    virtual void dataRead(const PropertyInfo& info)
+    {
+        bool ok = m_buffer.size() == 10 * Gto::dataSizeInBytes(info.readType());
+
+        for (size_t i = 0; ok && i < 10; i++)
+        {
+            if (info.readType() == Gto::Double) ok = ((double*)&m_buffer.front())[i] == fdata[i];
+            else ok = ((unsigned short*)&m_buffer.front())[i] == idata[i];
+        }
+
+        if (!ok)
+        {
+            cerr << "ERROR: bad converted data for " << info.fullName << endl;
+            errors++;
+        }
+
+        numRead++;
+    }
+
+    size_t numRead;
+    size_t errors;
+
+private:
+    vector<char> m_buffer;
+};
+
+int readConverted(const char* filename)
+{
+    cout << "reading " << filename << " converted" << endl;
+
+    ConvertingReader reader;
+    reader.open(filename);
+
+    ConvertingReader areader(Gto::Reader::ReadAhead);
+    areader.setReadAhead(17, 3);
+    areader.open(filename);
+
+    ConvertingReader mreader(Gto::Reader::MemoryMapped);
+    mreader.open(filename);
+
+    if (reader.numRead != 7 || reader.errors || 
+        areader.numRead != 7 || areader.errors ||
+        mreader.numRead != 7 || mreader.errors)
+    {
+        cerr << "ERROR: converted read failed" << endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+//
+//  Conversions with byte swapping, halfs and clamping
+//
+
+int convertValues()
+{
+    cout << "converting values" << endl;
+    int errors = 0;
+
+    const float f[] = { 1.0f, -2.5f, 65504.0f, 1e-7f, 1e6f, 0.0f };
+    unsigned short h[6];
+    float          back[6];
+    Gto::convertData(f, Gto::Float, h, Gto::Half, 6);
+    Gto::convertData(h, Gto::Half, back, Gto::Float, 6);
+
+    if (h[0] != 0x3c00 || h[1] != 0xc100 || h[2] != 0x7bff || h[4] != 0x7c00 ||
+        back[0] != 1.0f || back[1] != -2.5f || back[2] != 65504.0f || 
+        back[3] == 0.0f || back[5] != 0.0f)
+    {
+        cerr << "ERROR: bad half conversion" << endl;
+        errors++;
+    }
+
+    const int      ints[]  = { -5, 70000, 300, 1 };
+    unsigned short shorts[4];
+    unsigned char  bytes[4];
+    Gto::convertData(ints, Gto::Int, shorts, Gto::Short, 4);
+    Gto::convertData(ints, Gto::Int, bytes, Gto::Byte, 4);
+
+    if (shorts[0] != 0 || shorts[1] != 65535 || shorts[2] != 300 ||
+        bytes[1] != 255 || bytes[2] != 255 || bytes[3] != 1)
+    {
+        cerr << "ERROR: bad clamped conversion" << endl;
+        errors++;
+    }
+
+    const double   d[] = { 1.5, -3.25 };
+    unsigned char  swapped[sizeof(d)];
+    float          out[2];
+
+    for (size_t i = 0; i < sizeof(d); i++) 
+    {
+        swapped[i] = ((const unsigned char*)d)[i / 8 * 8 + 7 - i % 8];
+    }
+
+    Gto::convertData(swapped, Gto::Double, out, Gto::Float, 2, true);
+
+    if (out[0] != 1.5f || out[1] != -3.25f)
+    {
+        cerr << "ERROR: bad swapped conversion" << endl;
+        errors++;
+    }
+
+    return errors;
+}
+
+//
+//  Every half through the tables and the vector kernels, and the
+//  rounding of floats which fall between halfs
+//
+
+static bool
+sameFloat(float a, float b)
+{
+    return a != a ? b != b : memcmp(&a, &b, sizeof(float)) == 0;
+}
+
+int convertHalfs()
+{
+    cout << "converting halfs" << endl;
+    int errors = 0;
+
+    vector<unsigned short> h(65536);
+    vector<float>          f(65536);
+    vector<unsigned short> back(65536);
+
+    for (size_t i = 0; i < h.size(); i++) h[i] = (unsigned short)i;
+
+    //
+    //  Starting at 1 gives the kernels a tail
+    //
+
+    f[0] = Gto::halfToFloat(h[0]);
+    Gto::halfToFloat(&h[1], &f[1], h.size() - 1);
+    Gto::floatToHalf(&f[1], &back[1], f.size() - 1);
+
+    for (size_t i = 0; i < h.size(); i++)
+    {
+        float x      = Gto::halfToFloat(h[i]);
+        bool  nan    = x != x;
+        bool  backOk = i == 0 || (nan ? (back[i] & 0x7fff) > 0x7c00 : back[i] == h[i]);
+
+        if (!sameFloat(x, f[i]) || !backOk ||
+            (!nan && Gto::floatToHalf(x) != h[i]))
+        {
+            cerr << "ERROR: bad half conversion of " << i << endl;
+            errors++;
+            break;
+        }
+    }
+
+    const float in[]       = { 1.0f + 1.0f / 2048, 1.0f + 3.0f / 2048, 65519.0f,
+                               65520.0f, 1.0f / (1 << 25), 1.5f / (1 << 25),
+                               -1e-30f, 1e30f };
+    const unsigned short expected[] = { 0x3c00, 0x3c02, 0x7bff, 
+                                        0x7c00, 0x0000, 0x0001, 
+                                        0x8000, 0x7c00 };
+    unsigned short       out[8];
+
+    Gto::floatToHalf(in, out, 8);
+
+    for (size_t i = 0; i < 8; i++)
+    {
+        if (out[i] != expected[i] || Gto::floatToHalf(in[i]) != expected[i])
+        {
+            cerr << "ERROR: bad half rounding of " << in[i] << endl;
+            errors++;
+        }
+    }
+
+    return errors;
+}
+
+//
+//  A file with a property of each type. The sizes are odd so the
+//  vector byte swaps have tails.
+//
+
+const size_t numTyped = 1001;
+
+void writeTypes(const char* filename)
+{
+    cout << "writing " << filename << endl;
+
+    vector<float>          floats(numTyped * 3);
+    vector<double>         doubles(numTyped);
+    vector<int>            ints(numTyped);
+    vector<unsigned short> shorts(numTyped * 2);
+    vector<unsigned char>  bytes(numTyped);
+
+    for (size_t i = 0; i < floats.size(); i++) floats[i] = i * 0.25f - 100.0f;
+    for (size_t i = 0; i < doubles.size(); i++) doubles[i] = i * 1.0e-3 - 0.5;
+    for (size_t i = 0; i < ints.size(); i++) ints[i] = int(i * 65599) - 7;
+    for (size_t i = 0; i < shorts.size(); i++) shorts[i] = (unsigned short)(i * 251);
+    for (size_t i = 0; i < bytes.size(); i++) bytes[i] = (unsigned char)(i * 7);
+
+    Gto::Writer writer;
+    writer.open(filename, Gto::Writer::BinaryGTO);
+
+    writer.beginObject("typed", "data", 0);
+        writer.beginComponent("values");
+            writer.property("floats", Gto::Float, numTyped, 3);
+            writer.property("doubles", Gto::Double, numTyped);
+            writer.property("ints", Gto::Int, numTyped);
+            writer.property("shorts", Gto::Short, numTyped, 2);
+            writer.property("halfs", Gto::Half, numTyped);
+            writer.property("bytes", Gto::Byte, numTyped);
+        writer.endComponent();
+    writer.endObject();
+
+    writer.beginData();
+        writer.propertyData(&floats.front());
+        writer.propertyData(&doubles.front());
+        writer.propertyData(&ints.front());
+        writer.propertyData(&shorts.front());
+        writer.propertyDataRaw(&shorts.front());
+        writer.propertyData(&bytes.front());
+    writer.endData();
+}
+
+//
+//  Keeps a copy of the data of every property
+//
+
+class CopyingReader : public Gto::Reader
+{
+public:
+    CopyingReader(unsigned int mode = None) : Gto::Reader(mode) {}
+
+    virtual void* data(const PropertyInfo& info, size_t bytes)
+    {
+        vector<char>& buffer = values[info.fullName];
+        buffer.resize(bytes);
+        return &buffer.front();
+    }
+
+    virtual bool dataChunk(const PropertyInfo& info, 
+                           const void* p,
+                           size_t first,
+                           size_t count)
+    {
+        size_t bytes = count * elementSize(info.dims) * Gto::dataSizeInBytes(info.type);
+        values[info.fullName].insert(values[info.fullName].end(), 
+                                     (const char*)p, (const char*)p + bytes);
+        return true;
+    }
+
+    map<string, vector<char> > values;
+};
+
+//
+//  Writes a copy of an uncompressed binary file in the other byte
+//  order, as a machine of the other endianness would have written it
+//
+
+static void
+reverseWords(char* p, size_t bytes, size_t wordSize)
+{
+    for (size_t i = 0; i + wordSize <= bytes; i += wordSize)
+    {
+        std::reverse(p + i, p + i + wordSize);
+    }
+}
+
+bool byteSwapFile(const char* filename, const char* swappedName)
+{
+    ifstream in(filename, ios::binary);
+    vector<char> file((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+
+    Gto::Reader reader(Gto::Reader::RandomAccess);
+    if (!reader.open(&file.front(), file.size(), filename)) return false;
+
+    size_t stringBytes = 0;
+
+    for (size_t i = 0; i < reader.stringTable().size(); i++)
+    {
+        stringBytes += reader.stringTable()[i].size() + 1;
+    }
+
+    const Gto::Reader::Properties& props = reader.properties();
+    size_t strings = sizeof(Gto::Header);
+    size_t headers = strings + stringBytes;
+    size_t data    = props.empty() ? file.size() : size_t(props.front().offset);
+
+    reverseWords(&file[0], strings, 4);
+    reverseWords(&file[headers], data - headers, 4);
+
+    for (size_t i = 0; i < props.size(); i++)
+    {
+        const Gto::Reader::PropertyInfo& p = props[i];
+        size_t wordSize   = Gto::dataSizeInBytes(p.type);
+        size_t fieldBytes = elementSize(p.dims) * wordSize;
+
+        if (p.component->flags & Gto::Transposed)
+        {
+            size_t stride = reader.recordSize(*p.component);
+
+            for (size_t r = 0; r < p.size; r++)
+            {
+                reverseWords(&file[p.offset + r * stride], fieldBytes, wordSize);
+            }
+        }
+        else
+        {
+            reverseWords(&file[p.offset], p.size * fieldBytes, wordSize);
+        }
+    }
+
+    reader.close();
+    ofstream out(swappedName, ios::binary);
+    out.write(&file.front(), file.size());
+    return out.good();
+}
+
+//
+//  Block compressed files with a block count which would overflow the
+//  index size and with a block size much larger than the data must be
+//  rejected or read without throwing
+//
+
+int badBlockFiles(const char* filename)
+{
+    cout << "reading damaged copies of " << filename << endl;
+    int errors = 0;
+
+    write(filename, Gto::Writer::BlockCompressedGTO);
+    ifstream in(filename, ios::binary);
+    vector<char> file((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    in.close();
+
+    vector<char>       damaged  = file;
+    Gto::BlockTrailer* trailer  = (Gto::BlockTrailer*)&damaged[damaged.size() - sizeof(Gto::BlockTrailer)];
+    trailer->numBlocks          = Gto::uint64(1) << 60;
+
+    try
+    {
+        Gto::Reader reader;
+
+        if (reader.open(&damaged.front(), damaged.size(), filename))
+        {
+            cerr << "ERROR: bad block index was accepted" << endl;
+            errors++;
+        }
+    }
+    catch (...)
+    {
+        cerr << "ERROR: bad block index threw" << endl;
+        errors++;
+    }
+
+    damaged = file;
+    ((Gto::BlockHeader*)&damaged.front())->blockSize = 0xfffffff0;
+
+    ofstream out(filename, ios::binary);
+    out.write(&damaged.front(), damaged.size());
+    out.close();
+
+    try
+    {
+        errors += readAll(filename);
+    }
+    catch (...)
+    {
+        cerr << "ERROR: large block size threw" << endl;
+        errors++;
+    }
+
+    unlink(filename);
+    return errors;
+}
+
+//
+//  Reads a byte swapped copy of the file every way there is and
+//  compares the data with the original's
+//
+
+int byteSwapped(const char* filename)
+{
+    cout << "reading " << filename << " byte swapped" << endl;
+
+    string swappedName = string(filename) + ".swapped";
+    CopyingReader native;
+
+    if (!native.open(filename) || native.values.size() != 6 ||
+        !byteSwapFile(filename, swappedName.c_str()))
+    {
+        cerr << "ERROR: unable to make a byte swapped file: " << native.why() << endl;
+        return 1;
+    }
+
+    ifstream in(swappedName.c_str(), ios::binary);
+    vector<char> file((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+
+    const unsigned int modes[] = { Gto::Reader::None, 
+                                   Gto::Reader::MemoryMapped,
+                                   Gto::Reader::ReadAhead };
+    const char* names[] = { "file", "mapped", "read ahead", "in memory", "chunked" };
+    vector<char> chunk(1000);
+    int errors = 0;
+
+    for (int i = 0; i < 5; i++)
+    {
+        CopyingReader reader(i < 3 ? modes[i] : Gto::Reader::None);
+        bool ok = false;
+
+        if (i == 2) reader.setReadAhead(1237, 3);
+        if (i == 4) reader.setChunkBuffer(&chunk.front(), chunk.size());
+
+        if (i == 3) ok = reader.open(&file.front(), file.size(), swappedName.c_str());
+        else ok = reader.open(swappedName.c_str());
+
+        if (!ok || reader.values != native.values)
+        {
+            cerr << "ERROR: bad byte swapped data read from " << names[i] << endl;
+            errors++;
+        }
+    }
+
+    unlink(swappedName.c_str());
+    return errors;
+}
+
+int readRandom(const char *filename);
+
+//
+//  Random access to a gzip file through a GzipIndex
+//
+
+int readIndexed(const char *filename)
+{
+    cout << "indexing " << filename << endl;
+    Gto::GzipIndex index;
+    string         indexName = Gto::GzipIndex::indexName(filename);
+
+    if (!index.build(filename, 16) || !index.write(indexName.c_str()))
+    {
+        cerr << "ERROR: gzip index failed: " << index.why() << endl;
+        return 1;
+    }
+
+    int errors = readRandom(filename);
+
+    //
+    //  An index claiming more access points than the file holds is
+    //  rejected before anything is allocated for them
+    //
+
+    ifstream in(indexName.c_str(), ios::binary);
+    vector<char> file((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    in.close();
+
+    *(Gto::uint64*)&file[24] = Gto::uint64(1) << 60;
+    ofstream out(indexName.c_str(), ios::binary);
+    out.write(&file.front(), file.size());
+    out.close();
+
+    try
+    {
+        if (index.read(indexName.c_str()))
+        {
+            cerr << "ERROR: bad gzip index was accepted" << endl;
+            errors++;
+        }
+    }
+    catch (...)
+    {
+        cerr << "ERROR: bad gzip index threw" << endl;
+        errors++;
+    }
+
+    unlink(indexName.c_str());
+    return errors;
+}
+
+int readRandom(const char *filename)
+{
+    cout << "reading " << filename << " randomly" << endl;
+    TestReader reader(Gto::Reader::RandomAccess);
+
+    if (!reader.open(filename))
+    {
+        cerr << "ERROR: random access open failed: " << reader.why() << endl;
+        return 1;
+    }
+
+    Gto::Reader::Properties& props = reader.properties();
+
+    for (size_t i = props.size(); i-- > 0;)
+    {
+        reader.accessProperty(props[i]);
+    }
+
+    if (reader.numRead != 7 || reader.errors)
+    {
+        cerr << "ERROR: random access read failed" << endl;
+        return 1;
+    }
+
+    TestReader breader(Gto::Reader::RandomAccess);
+    breader.setNumThreads(4);
+
+    if (!breader.open(filename))
+    {
+        cerr << "ERROR: random access open failed: " << breader.why() << endl;
+        return 1;
+    }
+
+    vector<Gto::Reader::PropertyInfo*> batch;
+
+    for (size_t i = breader.properties().size(); i-- > 0;)
+    {
+        batch.push_back(&breader.properties()[i]);
+    }
+
+    if (!breader.accessProperties(batch) || 
+        breader.numRead != 7 || 
+        breader.errors)
+    {
+        cerr << "ERROR: batch random access read failed" << endl;
+        return 1;
+    }
+
+    TestReader areader(Gto::Reader::RandomAccess | Gto::Reader::AsyncIO);
+
+    if (!areader.open(filename))
+    {
+        cerr << "ERROR: random access open failed: " << areader.why() << endl;
+        return 1;
+    }
+
+    batch.clear();
+
+    for (size_t i = areader.properties().size(); i-- > 0;)
+    {
+        batch.push_back(&areader.properties()[i]);
+    }
+
+    if (!areader.accessProperties(batch) || 
+        areader.numRead != 7 || 
+        areader.errors)
+    {
+        cerr << "ERROR: async batch random access read failed" << endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+//
+//  Large properties written with shuffle and delta filters. They span
+//  several filter blocks and end in a partial one.
+//
+
+const size_t numFiltered = 70001;
+
+float  filteredFloat(size_t i)  { return float(i % 977) * 0.25f - 100.0f; }
+int    filteredInt(size_t i)    { return int(i * 7) - 1000; }
+double filteredDouble(size_t i) { return double(i) / 3.0; }
+short  filteredShort(size_t i)  { return short(i * 3); }
+
+class FilteredReader : public Gto::Reader
+{
+public:
+    FilteredReader(size_t chunkSize = 0, unsigned int mode = None) 
+        : Gto::Reader(mode), 
+          numRead(0), 
+          errors(0), 
+          first(0), 
+          count(numFiltered), 
+          convertTo(Gto::ErrorType),
+          m_chunk(chunkSize) 
+    {
+        if (chunkSize) setChunkBuffer(&m_chunk.front(), chunkSize);
+    }
+
+    virtual Request property(const string& name,
+                             const string& interp,
+                             const PropertyInfo& info)
+    {
+        return Request(true, 0, convertTo);
+    }
+
+    virtual void* data(const PropertyInfo& info, size_t bytes)
+    {
+        m_buffer.resize(bytes);
+        return &m_buffer.front();
+    }
+
+    virtual bool dataChunk(const PropertyInfo& info, 
+                           const void* data,
+                           size_t firstElement,
+                           size_t numElements)
+    {
+        size_t elementBytes = 3 * Gto::dataSizeInBytes(info.type);
+        if (firstElement == first) m_buffer.clear();
+
+        if ((firstElement - first) * elementBytes != m_buffer.size() || 
+            numElements * elementBytes > m_chunk.size())
+        {
+            cerr << "ERROR: bad chunk for " << info.fullName << endl;
+            errors++;
+        }
+
+        const char* p = (const char*)data;
+        m_buffer.insert(m_buffer.end(), p, p + numElements * elementBytes);
+        return true;
+    }
+
+    virtual void dataRead(const PropertyInfo& info)
+    {
+        const char* p = &m_buffer.front();
+        bool ok = info.size == numFiltered &&
+                  m_buffer.size() == count * 3 * Gto::dataSizeInBytes(info.readType());
+
+        for (size_t q = 0; ok && q < count * 3; q++)
+        {
+            size_t i = first * 3 + q;
+
+            if (info.readType() != info.type)
+            {
+                double v = ((double*)p)[q];
+
+                switch (info.type)
+                {
+                  case Gto::Float:  ok = v == filteredFloat(i); break;
+                  case Gto::Int:    ok = v == filteredInt(i); break;
+                  case Gto::Short:  ok = v == (unsigned short)filteredShort(i); break;
+                  case Gto::Byte:   ok = v == (unsigned char)i; break;
+                  default: ok = false;
+                }
+
+                continue;
+            }
+
+            switch (info.type)
+            {
+              case Gto::Float:  ok = ((float*)p)[q] == filteredFloat(i); break;
+              case Gto::Int:    ok = ((int*)p)[q] == filteredInt(i); break;
+              case Gto::Double: ok = ((double*)p)[q] == filteredDouble(i); break;
+              case Gto::Short:  ok = ((short*)p)[q] == filteredShort(i); break;
+              case Gto::Byte:   ok = p[q] == char(i); break;
+              default: ok = false;
+            }
+        }
+
+        if (!ok)
+        {
+            cerr << "ERROR: bad filtered data for " << info.fullName << endl;
+            errors++;
+        }
+
+        numRead++;
+    }
+
+    size_t numRead;
+    size_t errors;
+    size_t first;       // range expected by dataRead()
+    size_t count;
+    Gto::DataType convertTo;
+
+private:
+    vector<char> m_buffer;
+    vector<char> m_chunk;
+};
+
+//
+//  An attribute interleaved with other data for propertyDataStrided()
+//
+
+struct FilteredPoint
+{
+    int     id[3];
+    float   other;
+};
+
+int filtered(const char* filename, 
+             Gto::Writer::FileType type, 
+             bool scattered = false,
+             size_t chunkSize = 0)
+{
+    cout << "writing and reading " << filename << " filtered" 
+         << (scattered ? " from scattered data" : "") 
+         << (chunkSize ? " in chunks" : "") << endl;
+
+    const size_t   n = numFiltered * 3;
+    vector<float>  f(n);
+    vector<int>    i(n);
+    vector<double> d(n);
+    vector<short>  s(n);
+    vector<char>   b(n);
+
+    for (size_t q = 0; q < n; q++)
+    {
+        f[q] = filteredFloat(q);
+        i[q] = filteredInt(q);
+        d[q] = filteredDouble(q);
+        s[q] = filteredShort(q);
+        b[q] = char(q);
+    }
+
+    {
+        Gto::Writer writer;
+        writer.open(filename, type);
+        writer.setPropertyFilters(Gto::AllFilters);
+
+        writer.beginObject("particles", "particle", 1);
+            writer.beginComponent("points");
+                writer.property("position", Gto::Float, numFiltered, 3);
+                writer.property("id", Gto::Int, numFiltered, 3);
+                writer.property("time", Gto::Double, numFiltered, 3);
+                writer.property("index", Gto::Short, numFiltered, 3);
+                writer.property("flags", Gto::Byte, numFiltered, 3);
+            writer.endComponent();
+        writer.endObject();
+
+        writer.beginData();
+
+        if (scattered)
+        {
+            //
+            //  Span boundaries which don't fall on words or filter
+            //  blocks
+            //
+
+            const char* fp = (const char*)&f.front();
+            size_t      fn = n * sizeof(float);
+
+            Gto::Writer::DataSpan spans[3];
+            spans[0] = Gto::Writer::DataSpan(fp, 1001);
+            spans[1] = Gto::Writer::DataSpan(fp + 1001, 100003);
+            spans[2] = Gto::Writer::DataSpan(fp + 101004, fn - 101004);
+
+            vector<FilteredPoint> points(numFiltered);
+
+            for (size_t q = 0; q < numFiltered; q++)
+            {
+                points[q].id[0] = i[q*3+0];
+                points[q].id[1] = i[q*3+1];
+                points[q].id[2] = i[q*3+2];
+                points[q].other = 0;
+            }
+
+            writer.propertyDataSpans(spans, 3);
+            writer.propertyDataStrided(points.front().id, 
+                                       sizeof(FilteredPoint));
+            writer.propertyDataInContainer(deque<double>(d.begin(), d.end()));
+            writer.propertyDataInContainer(list<short>(s.begin(), s.end()));
+
+            writer.beginPropertyData("flags");
+
+            for (size_t q = 0; q < n; q += 997)
+            {
+                writer.appendPropertyData(&b[q], std::min(n - q, size_t(997)));
+            }
+
+            writer.endPropertyData();
+        }
+        else
+        {
+            writer.propertyData(f);
+            writer.propertyData(i);
+            writer.propertyData(d);
+            writer.propertyData(s);
+            writer.propertyData(b);
+        }
+
+        writer.endData();
+    }
+
+    FilteredReader reader(chunkSize);
+
+    if (!reader.open(filename) || reader.numRead != 5 || reader.errors)
+    {
+        cerr << "ERROR: filtered read failed: " << reader.why() << endl;
+        unlink(filename);
+        return 1;
+    }
+
+    FilteredReader converted(chunkSize);
+    converted.convertTo = Gto::Double;
+
+    if (!converted.open(filename) || converted.numRead != 5 || converted.errors)
+    {
+        cerr << "ERROR: converted filtered read failed: " << converted.why() << endl;
+        unlink(filename);
+        return 1;
+    }
+
+    FilteredReader ahead(chunkSize, Gto::Reader::ReadAhead);
+    ahead.setReadAhead(4097, 3);
+
+    if (!ahead.open(filename) || ahead.numRead != 5 || ahead.errors)
+    {
+        cerr << "ERROR: filtered read ahead failed: " << ahead.why() << endl;
+        unlink(filename);
+        return 1;
+    }
+
+    string indexName = Gto::GzipIndex::indexName(filename);
+
+    if (type == Gto::Writer::CompressedGTO && Gto::CompressedFile::supported())
+    {
+        //
+        //  The slices are read through an index with access points
+        //  inside deflate streams
+        //
+
+        Gto::GzipIndex index;
+
+        if (!index.build(filename, 65536) || 
+            !index.write(indexName.c_str()) ||
+            index.numPoints() < 2)
+        {
+            cerr << "ERROR: gzip index failed: " << index.why() << endl;
+            unlink(filename);
+            return 1;
+        }
+    }
+
+    if (type != Gto::Writer::CompressedGTO || Gto::CompressedFile::supported())
+    {
+        //
+        //  Slices which start and end inside filter blocks
+        //
+
+        for (int c = 0; c < 2; c++)
+        {
+            FilteredReader ranges(chunkSize, Gto::Reader::RandomAccess);
+            bool ok = ranges.open(filename);
+            ranges.first = 12345;
+            ranges.count = 23456;
+            if (c) ranges.convertTo = Gto::Double;
+
+            for (size_t q = 0; ok && q < ranges.properties().size(); q++)
+            {
+                ok = ranges.accessPropertyRange(ranges.properties()[q], 
+                                                ranges.first, ranges.count);
+            }
+
+            ok = ok && !ranges.accessPropertyRange(ranges.properties()[0], 
+                                                   numFiltered - 1, 2);
+
+            if (!ok || ranges.numRead != 5 || ranges.errors)
+            {
+                cerr << "ERROR: filtered range read failed: " << ranges.why() << endl;
+                unlink(filename);
+                unlink(indexName.c_str());
+                return 1;
+            }
+        }
+    }
+
+    unlink(filename);
+    unlink(indexName.c_str());
+    return 0;
+}
+
+//
+//  A transposed component (stored as records) and an ordinary one
+//
+
+const size_t numRecords = 5003;
+
+double recordValue(Gto::uint32 type, size_t i)
+{
+    switch (type)
+    {
+      case Gto::Float:  return i * 0.5f - 7.0f;
+      case Gto::Int:    return int(i * 3) - 7;
+      case Gto::Double: return i * 1.0e-3 + 0.25;
+      case Gto::Short:  return (unsigned short)(i * 13);
+      case Gto::Byte:   return (unsigned char)(i * 7);
+      default:          return 0;
+    }
+}
+
+double loadValue(const char* p, Gto::uint32 type)
+{
+    float f; int i; double d; unsigned short s;
+
+    switch (type)
+    {
+      case Gto::Float:  memcpy(&f, p, 4); return f;
+      case Gto::Int:    memcpy(&i, p, 4); return i;
+      case Gto::Double: memcpy(&d, p, 8); return d;
+      case Gto::Short:  memcpy(&s, p, 2); return s;
+      case Gto::Byte:   return (unsigned char)*p;
+      default:          return 0;
+    }
+}
+
+template <typename T>
+vector<T> recordValues(Gto::uint32 type, size_t n)
+{
+    vector<T> values(n);
+    for (size_t i = 0; i < n; i++) values[i] = T(recordValue(type, i));
+    return values;
+}
+
+void writeRecords(const char* filename, Gto::Writer::FileType type, bool streaming)
+{
+    vector<float>          positions = recordValues<float>(Gto::Float, numRecords * 3);
+    vector<int>            ids       = recordValues<int>(Gto::Int, numRecords);
+    vector<double>         masses    = recordValues<double>(Gto::Double, numRecords);
+    vector<unsigned short> flags     = recordValues<unsigned short>(Gto::Short, numRecords);
+    vector<unsigned char>  tags      = recordValues<unsigned char>(Gto::Byte, numRecords);
+
+    Gto::Writer writer;
+    writer.setStreaming(streaming);
+    writer.setPropertyFilters(Gto::AllFilters);   // ignored when transposed
+    writer.open(filename, type);
+
+    writer.beginObject("particles", "particle", 1);
+        writer.beginComponent("points", Gto::Transposed);
+            writer.property("position", Gto::Float, numRecords, 3);
+            if (streaming) writer.propertyData(&positions.front());
+            writer.property("id", Gto::Int, numRecords);
+            if (streaming) writer.propertyData(&ids.front());
+            writer.property("mass", Gto::Double, numRecords);
+            if (streaming) writer.propertyData(&masses.front());
+            writer.property("flags", Gto::Short, numRecords);
+            if (streaming) writer.propertyData(&flags.front());
+            writer.property("tag", Gto::Byte, numRecords);
+            if (streaming) writer.propertyData(&tags.front());
+        writer.endComponent();
+        writer.setPropertyFilters(Gto::NoFilter);
+        writer.beginComponent("other");
+            writer.property("values", Gto::Int, 10);
+            if (streaming) writer.propertyData(idata);
+        writer.endComponent();
+    writer.endObject();
+
+    if (!streaming)
+    {
+        writer.beginData();
+            writer.propertyData(&positions.front());
+            writer.beginPropertyData();
+                writer.appendPropertyData(&ids.front(), 1000);
+                writer.appendPropertyData(&ids[1000], numRecords - 1000);
+            writer.endPropertyData();
+            writer.propertyData(&masses.front());
+            writer.propertyData(&flags.front());
+            writer.propertyData(&tags.front());
+            writer.propertyData(idata);
+        writer.endData();
+    }
+}
+
+//
+//  Checks the properties of the transposed component as they're
+//  delivered transposed back, or the records themselves if asIs
+//
+
+class RecordReader : public Gto::Reader
+{
+public:
+    RecordReader(unsigned int mode = None) 
+        : Gto::Reader(mode), 
+          asIs(false),
+          convertTo(Gto::ErrorType),
+          first(0),
+          count(numRecords),
+          numRead(0), 
+          numRecordsRead(0), 
+          errors(0) {}
+
+    virtual Request property(const string& name,
+                             const string& interp,
+                             const PropertyInfo& info)
+    {
+        bool transposed = info.component->flags & Gto::Transposed;
+        return Request(true, 0, transposed ? convertTo : Gto::ErrorType);
+    }
+
+    virtual void* data(const PropertyInfo& info, size_t bytes)
+    {
+        vector<char>& buffer = m_buffers[info.fullName];
+        buffer.resize(bytes);
+        return &buffer.front();
+    }
+
+    virtual void dataRead(const PropertyInfo& info)
+    {
+        const vector<char>& buffer = m_buffers[info.fullName];
+        bool ok = true;
+
+        if (!(info.component->flags & Gto::Transposed))
+        {
+            ok = buffer.size() == sizeof(idata) && !memcmp(&buffer.front(), idata, sizeof(idata));
+        }
+        else
+        {
+            size_t values  = elementSize(info.dims);
+            size_t outSize = Gto::dataSizeInBytes(info.readType());
+            ok = buffer.size() == count * values * outSize;
+
+            for (size_t v = 0; ok && v < count * values; v++)
+            {
+                ok = loadValue(&buffer[v * outSize], info.readType()) == 
+                     recordValue(info.type, first * values + v);
+            }
+        }
+
+        if (!ok)
+        {
+            cerr << "ERROR: bad data for " << info.fullName << endl;
+            errors++;
+        }
+
+        numRead++;
+    }
+
+    virtual void* transposedData(const ComponentInfo& info, size_t bytes)
+    {
+        if (!asIs) return 0;
+        m_records.resize(bytes);
+        return &m_records.front();
+    }
+
+    virtual void transposedDataRead(const ComponentInfo& info)
+    {
+        size_t recordBytes = recordSize(info);
+        bool   ok          = recordBytes == 27 && m_records.size() == numRecords * recordBytes;
+
+        for (size_t q = 0; ok && q < info.numProperties; q++)
+        {
+            const PropertyInfo& p      = properties()[info.propertyOffset() + q];
+            size_t              values = elementSize(p.dims);
+            size_t              offset = fieldOffset(p);
+
+            for (size_t r = 0; ok && r < numRecords; r++)
+            {
+                for (size_t v = 0; ok && v < values; v++)
+                {
+                    const char* field = &m_records[r * recordBytes + offset];
+                    ok = loadValue(field + v * Gto::dataSizeInBytes(p.type), p.type) ==
+                         recordValue(p.type, r * values + v);
+                }
+            }
+        }
+
+        if (!ok)
+        {
+            cerr << "ERROR: bad records for " << info.fullName << endl;
+            errors++;
+        }
+
+        numRecordsRead++;
+    }
+
+    bool          asIs;
+    Gto::DataType convertTo;
+    size_t        first;
+    size_t        count;
+    size_t        numRead;
+    size_t        numRecordsRead;
+    size_t        errors;
+
+private:
+    map<string, vector<char> > m_buffers;
+    vector<char>               m_records;
+};
+
+//
+//  Float properties stored as halfs, written through each of the
+//  Writer's data functions. The halfs are read back as floats.
+//
+
+const size_t numHalfs = 3001;
+
+static float
+halfSource(size_t i)
+{
+    return float(i) * 0.1f - 50.0f;
+}
+
+class HalfReader : public Gto::Reader
+{
+public:
+    HalfReader() : Gto::Reader() {}
+
+    virtual Request property(const string& name,
+                             const string& interp,
+                             const PropertyInfo& info)
+    {
+        types[info.fullName] = info.type;
+        return Request(true, 0, info.type == Gto::Half ? Gto::Float : Gto::DataType(info.type));
+    }
+
+    virtual void* data(const PropertyInfo& info, size_t bytes)
+    {
+        vector<char>& buffer = values[info.fullName];
+        buffer.resize(bytes);
+        return &buffer.front();
+    }
+
+    map<string, unsigned int>  types;
+    map<string, vector<char> > values;
+};
+
+int halfs(const char* filename, Gto::Writer::FileType type, bool streaming)
+{
+    cout << "writing and reading " << filename << " halfs" 
+         << (streaming ? " streamed" : "") << endl;
+
+    vector<float> floats(numHalfs * 4);
+    vector<int>   ids(numHalfs);
+
+    for (size_t i = 0; i < floats.size(); i++) floats[i] = halfSource(i);
+    for (size_t i = 0; i < ids.size(); i++) ids[i] = int(i);
+
+    Gto::Writer writer;
+    writer.setStreaming(streaming);
+    writer.open(filename, type);
+    writer.setFloatsAsHalf(true);
+
+    writer.beginObject("particles", "particle", 1);
+        writer.beginComponent("points");
+            writer.property("position", Gto::Float, numHalfs, 3);
+            writer.setPropertyFilters(Gto::AllFilters);
+            writer.property("velocity", Gto::Float, numHalfs, 3);
+            writer.setPropertyFilters(Gto::NoFilter);
+            writer.property("color", Gto::Float, numHalfs, 3);
+            writer.property("id", Gto::Int, numHalfs);
+            writer.setFloatsAsHalf(false);
+            writer.property("mass", Gto::Float, numHalfs);
+            writer.setFloatsAsHalf(true);
+        writer.endComponent();
+
+        writer.beginComponent("records", Gto::Transposed);
+            writer.property("weight", Gto::Float, numHalfs);
+            writer.property("index", Gto::Int, numHalfs);
+        writer.endComponent();
+    writer.endObject();
+
+    if (!streaming) writer.beginData();
+
+    writer.propertyData(&floats.front());
+
+    writer.beginPropertyData();
+        writer.appendPropertyData(&floats.front(), 1000 * 3);
+        writer.appendPropertyData(&floats[1000 * 3], (numHalfs - 1000) * 3);
+    writer.endPropertyData();
+
+    writer.propertyDataStrided(&floats.front(), sizeof(float) * 4);
+    writer.propertyData(&ids.front());
+    writer.propertyData(&floats.front());
+    writer.propertyData(&floats.front());
+    writer.propertyData(&ids.front());
+
+    if (!streaming) writer.endData();
+    writer.close();
+
+    HalfReader reader;
+    int        errors = 0;
+
+    if (!reader.open(filename))
+    {
+        cerr << "ERROR: failed to read " << filename << endl;
+        return 1;
+    }
+
+    const char*  names[]   = { "points.position", 
+                               "points.velocity",
+                               "points.color", 
+                               "points.mass",
+                               "records.weight" };
+    const size_t widths[]  = { 3, 3, 3, 1, 1 };
+    const size_t strides[] = { 3, 3, 4, 1, 1 };
+
+    for (size_t p = 0; p < 5; p++)
+    {
+        const vector<char>& buffer = reader.values[names[p]];
+        const float*        values = buffer.empty() ? 0 : (const float*)&buffer.front();
+        const bool          half   = p != 3;
+        bool ok = reader.types[names[p]] == unsigned(half ? Gto::Half : Gto::Float) &&
+                  buffer.size() == numHalfs * widths[p] * sizeof(float);
+
+        for (size_t i = 0; ok && i < numHalfs; i++)
+        {
+            for (size_t q = 0; ok && q < widths[p]; q++)
+            {
+                float x = floats[i * strides[p] + q];
+                if (half) x = Gto::halfToFloat(Gto::floatToHalf(x));
+                ok = values[i * widths[p] + q] == x;
+            }
+        }
+
+        if (!ok)
+        {
+            cerr << "ERROR: bad half data for " << names[p] << endl;
+            errors++;
+        }
+    }
+
+    const vector<char>& index = reader.values["records.index"];
+
+    if (reader.types["points.id"] != Gto::Int ||
+        index.size() != numHalfs * sizeof(int) ||
+        memcmp(&index.front(), &ids.front(), index.size()))
+    {
+        cerr << "ERROR: bad int data with halfs" << endl;
+        errors++;
+    }
+
+    unlink(filename);
+    return errors;
+}
+
+int transposed(const char* filename, Gto::Writer::FileType type, bool streaming)
+{
+    cout << "writing and reading " << filename << " transposed" 
+         << (streaming ? " streamed" : "") << endl;
+
+    writeRecords(filename, type, streaming);
+
+    RecordReader reader;
+    RecordReader records;
+    RecordReader converted;
+    RecordReader ahead(Gto::Reader::ReadAhead);
+    records.asIs = true;
+    converted.convertTo = Gto::Double;
+    converted.setNumThreads(3);
+    ahead.setReadAhead(1000, 3);
+
+    if (!reader.open(filename) || reader.numRead != 6 || reader.errors ||
+        !records.open(filename) || records.numRead != 1 || 
+        records.numRecordsRead != 1 || records.errors ||
+        !converted.open(filename) || converted.numRead != 6 || converted.errors ||
+        !ahead.open(filename) || ahead.numRead != 6 || ahead.errors)
+    {
+        cerr << "ERROR: transposed read failed" << endl;
+        unlink(filename);
+        return 1;
+    }
+
+    //
+    //  Random access to the fields
+    //
+
+    RecordReader random(Gto::Reader::RandomAccess);
+    bool ok = random.open(filename);
+
+    Gto::Reader::PropertyInfo*  position = random.findProperty("particles.points.position");
+    Gto::Reader::PropertyInfo*  mass     = random.findProperty("particles.points.mass");
+    Gto::Reader::PropertyInfo*  tag      = random.findProperty("particles.points.tag");
+    Gto::Reader::PropertyInfo*  values   = random.findProperty("particles.other.values");
+    Gto::Reader::ComponentInfo* points   = random.findComponent("particles.points");
+
+    ok = ok && position && mass && tag && values && points;
+    ok = ok && random.accessProperty(*position) && random.accessComponent(*points);
+
+    if (ok)
+    {
+        vector<Gto::Reader::PropertyInfo*> batch;
+        batch.push_back(tag);
+        batch.push_back(values);
+        batch.push_back(position);
+        ok = random.accessProperties(batch);
+    }
+
+    random.first = 1234;
+    random.count = 100;
+    ok = ok && random.accessPropertyRange(*mass, 1234, 100);
+
+    if (!ok || random.numRead != 10 || random.errors)
+    {
+        cerr << "ERROR: transposed random access failed: " << random.why() << endl;
+        unlink(filename);
+        return 1;
+    }
+
+    if (type == Gto::Writer::BinaryGTO && !streaming)
+    {
+        //
+        //  From memory and byte swapped
+        //
+
+        ifstream in(filename, ios::binary);
+        vector<char> file((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+        string swappedName = string(filename) + ".swapped";
+
+        RecordReader memory;
+        RecordReader swapped;
+        RecordReader swappedRecords;
+        swappedRecords.asIs = true;
+
+        if (!memory.open(&file.front(), file.size(), filename) || 
+            memory.numRead != 6 || memory.errors ||
+            !byteSwapFile(filename, swappedName.c_str()) ||
+            !swapped.open(swappedName.c_str()) || !swapped.isSwapped() ||
+            swapped.numRead != 6 || swapped.errors ||
+            !swappedRecords.open(swappedName.c_str()) || 
+            swappedRecords.numRecordsRead != 1 || swappedRecords.errors)
+        {
+            cerr << "ERROR: transposed read from memory or swapped failed" << endl;
+            unlink(swappedName.c_str());
+            unlink(filename);
+            return 1;
+        }
+
+        unlink(swappedName.c_str());
+
+        //
+        //  The properties have to be the same size
+        //
+
+        string badName = string(filename) + ".bad";
+        bool   thrown  = false;
+
+        try
+        {
+            Gto::Writer writer;
+            writer.open(badName.c_str(), type);
+            writer.beginObject("bad", "bad", 1);
+            writer.beginComponent("points", Gto::Transposed);
+            writer.property("a", Gto::Float, 10);
+            writer.property("b", Gto::Float, 11);
+        }
+        catch (std::runtime_error&)
+        {
+            thrown = true;
+        }
+
+        unlink(badName.c_str());
+
+        if (!thrown)
+        {
+            cerr << "ERROR: transposed properties of different sizes were accepted" << endl;
+            unlink(filename);
+            return 1;
+        }
+    }
+
+    unlink(filename);
+    return 0;
+}
+
+//
+//  Writes a file larger than 4GB and reads parts of it back in
+//  RandomAccess mode. Only done when GTO_TEST_LARGE_FILES is set in
+//  the environment because of the time and disk space it takes.
+//
+
+const size_t numLarge     = 18;
+const size_t largeSize    = 64 * 1024 * 1024;   // ints per property
+const size_t numLargeRead = 3;
+
+class LargeReader : public Gto::Reader
+{
+public:
+    LargeReader() : Gto::Reader(RandomAccess), numRead(0), errors(0) {}
+
+    virtual void* data(const PropertyInfo& info, size_t bytes)
+    {
+        m_buffer.resize(bytes / sizeof(int));
+        return &m_buffer.front();
+    }
+
+    virtual void dataRead(const PropertyInfo& info)
+    {
+        const string name  = stringFromId(info.name);
+        const int    index = atoi(name.c_str() + name.find('_') + 1);
+        bool         ok    = m_buffer[0] == index;
+
+        if (name.find("large_") == 0)
+        {
+            ok = ok && m_buffer.size() == largeSize;
+            for (size_t i = 1; ok && i < m_buffer.size(); i++) ok = m_buffer[i] == int(i);
+        }
+
+        if (!ok)
+        {
+            cerr << "ERROR: bad data for " << info.fullName 
+                 << " at offset " << info.offset << endl;
+            errors++;
+        }
+
+        numRead++;
+    }
+
+    size_t numRead;
+    size_t errors;
+
+private:
+    vector<int> m_buffer;
+};
+
+int large(const char* filename, Gto::Writer::FileType type)
+{
+    cout << "writing and reading " << filename << " (large)" << endl;
+
+    {
+        vector<int> data(largeSize);
+        for (size_t i = 0; i < largeSize; i++) data[i] = int(i);
+
+        Gto::Writer writer;
+        writer.open(filename, type);
+
+        writer.beginObject("large", "data", 1);
+            writer.beginComponent("points");
+
+            for (size_t i = 0; i < numLarge; i++)
+            {
+                ostringstream large, marker;
+                large << "large_" << i;
+                marker << "marker_" << i;
+                writer.property(large.str().c_str(), Gto::Int, largeSize);
+                writer.property(marker.str().c_str(), Gto::Int, 1);
+            }
+
+            writer.endComponent();
+        writer.endObject();
+
+        writer.beginData();
+
+        for (size_t i = 0; i < numLarge; i++)
+        {
+            int marker = int(i);
+            data[0] = int(i);
+            writer.propertyData(data);
+            writer.propertyData(&marker);
+        }
+
+        writer.endData();
+    }
+
+    //
+    //  Read the markers and the last few large properties backwards
+    //
+
+    LargeReader reader;
+    int errors = 0;
+
+    if (!reader.open(filename))
+    {
+        cerr << "ERROR: large read failed: " << reader.why() << endl;
+        unlink(filename);
+        return 1;
+    }
+
+    Gto::Reader::Properties& props = reader.properties();
+
+    if (props.back().offset <= (Gto::uint64(1) << 32))
+    {
+        cerr << "ERROR: large file is not large" << endl;
+        errors++;
+    }
+
+    for (size_t i = props.size(); i-- > 0;)
+    {
+        if (i % 2 || i / 2 >= numLarge - numLargeRead) reader.accessProperty(props[i]);
+    }
+
+    if (reader.numRead != numLarge + numLargeRead || reader.errors)
+    {
+        cerr << "ERROR: large random read failed: " << reader.why() << endl;
+        errors++;
+    }
+
+    unlink(filename);
+    return errors;
+}
+
 int main(int, char**)
 {
     struct stat s;
+    int errors = 0;
+    errors += convertValues();
+    errors += convertHalfs();
     write("test.gto");
     read("test.gto");
+    errors += readConverted("test.gto");
+    errors += readMapped("test.gto", !Gto::CompressedFile::supported());
+    errors += readAhead("test.gto");
     unlink("test.gto");
 
+    if (Gto::CompressedFile::supported())
+    {
+        write("test_parallel.gto", Gto::Writer::CompressedGTO, 64, 4);
+        errors += readMapped("test_parallel.gto", false);
+        errors += readRandom("test_parallel.gto");
+        errors += readAhead("test_parallel.gto");
+        errors += readIndexed("test_parallel.gto");
+        unlink("test_parallel.gto");
+    }
+
+    write("test_blocks_parallel.gto", Gto::Writer::BlockCompressedGTO, 64, 4);
+    errors += readAll("test_blocks_parallel.gto");
+    errors += readRandom("test_blocks_parallel.gto");
+    unlink("test_blocks_parallel.gto");
+
+    errors += writeBorrowed("test_borrowed.gto", Gto::Writer::BinaryGTO);
+    errors += readAll("test_borrowed.gto");
+    errors += readRandom("test_borrowed.gto");
+    unlink("test_borrowed.gto");
+
+    errors += writeBorrowed("test_borrowed_blocks.gto", 
+                            Gto::Writer::BlockCompressedGTO);
+    errors += readAll("test_borrowed_blocks.gto");
+    unlink("test_borrowed_blocks.gto");
+
+    write("test_binary.gto", Gto::Writer::BinaryGTO);
+    errors += readMapped("test_binary.gto", true);
+    errors += readConverted("test_binary.gto");
+    errors += readRandom("test_binary.gto");
+    errors += readAhead("test_binary.gto");
+    unlink("test_binary.gto");
+
+    errors += badBlockFiles("test_bad_blocks.gto");
+
+    write("test_blocks.gto", Gto::Writer::BlockCompressedGTO, 64);
+    errors += readAll("test_blocks.gto");
+    errors += readConverted("test_blocks.gto");
+    errors += readRandom("test_blocks.gto");
+    errors += readMapped("test_blocks.gto", false);
+    unlink("test_blocks.gto");
+
+    writeStreamed("test_streamed.gto", Gto::Writer::BinaryGTO);
+    errors += readAll("test_streamed.gto");
+    errors += readRandom("test_streamed.gto");
+    errors += readMapped("test_streamed.gto", true);
+    errors += readAhead("test_streamed.gto");
+    unlink("test_streamed.gto");
+
+    if (Gto::CompressedFile::supported())
+    {
+        writeStreamed("test_streamed.gto.gz");
+        errors += readMapped("test_streamed.gto.gz", false);
+        errors += readRandom("test_streamed.gto.gz");
+        errors += readAhead("test_streamed.gto.gz");
+        errors += readIndexed("test_streamed.gto.gz");
+        unlink("test_streamed.gto.gz");
+    }
+
+    writeStreamed("test_streamed_blocks.gto", Gto::Writer::BlockCompressedGTO);
+    errors += readAll("test_streamed_blocks.gto");
+    errors += readRandom("test_streamed_blocks.gto");
+    unlink("test_streamed_blocks.gto");
+
+    write("test_lz4.gto", Gto::Writer::LZ4CompressedGTO, 64);
+    errors += readAll("test_lz4.gto");
+    errors += readRandom("test_lz4.gto");
+    unlink("test_lz4.gto");
+
+    write("test_zstd.gto", Gto::Writer::ZstdCompressedGTO, 64);
+    errors += readAll("test_zstd.gto");
+    errors += readRandom("test_zstd.gto");
+    unlink("test_zstd.gto");
+
+    errors += readCompact("test_compact.gto");
+    writeTypes("test_types.gto");
+    errors += byteSwapped("test_types.gto");
+    unlink("test_types.gto");
+    errors += readStrings("test_strings.gto", Gto::Writer::BinaryGTO);
+    errors += readStrings("test_strings_blocks.gto", Gto::Writer::BlockCompressedGTO);
+
+    if (Gto::CompressedFile::supported())
+    {
+        errors += readStrings("test_strings.gto.gz", Gto::Writer::CompressedGTO);
+    }
+
+    errors += filtered("test_filtered.gto", Gto::Writer::CompressedGTO);
+    errors += filtered("test_filtered_blocks.gto", Gto::Writer::BlockCompressedGTO);
+    errors += filtered("test_scattered.gto", Gto::Writer::BinaryGTO, true);
+    errors += filtered("test_chunked.gto", Gto::Writer::BinaryGTO, false, 1000);
+    errors += filtered("test_chunked_blocks.gto", 
+                       Gto::Writer::BlockCompressedGTO, false, 100000);
+    errors += transposed("test_transposed.gto", Gto::Writer::BinaryGTO, false);
+    errors += transposed("test_transposed_streamed.gto", Gto::Writer::BinaryGTO, true);
+    errors += transposed("test_transposed_blocks.gto", 
+                         Gto::Writer::BlockCompressedGTO, false);
+
+    if (Gto::CompressedFile::supported())
+    {
+        errors += transposed("test_transposed.gto.gz", Gto::Writer::CompressedGTO, false);
+    }
+
+    errors += halfs("test_halfs.gto", Gto::Writer::BinaryGTO, false);
+    errors += halfs("test_halfs_streamed.gto", Gto::Writer::BinaryGTO, true);
+    errors += halfs("test_halfs_blocks.gto", Gto::Writer::BlockCompressedGTO, false);
+
+    if (getenv("GTO_TEST_LARGE_FILES"))
+    {
+        errors += large("test_large.gto", Gto::Writer::BinaryGTO);
+    }
+
     if (stat("big_endian.gto",&s) != -1) read("big_endian.gto");
     if (stat("little_endian.gto",&s) != -1) read("little_endian.gto");
+
+    return errors;
 }